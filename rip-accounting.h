@@ -0,0 +1,263 @@
+// Data plane drop and forwarding loop accounting.
+
+#ifndef RIP_ACCOUNTING_H
+#define RIP_ACCOUNTING_H
+
+#include "rip-common.h"
+
+#include "ns3/traffic-control-module.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+
+namespace ns3
+{
+
+// Data plane drop counters per node, reason and time bucket, fed by the IPv4
+// drop trace, device and queue disc drops. Device drops on a failed link are
+// told apart from full queues. Packets forwarded twice by
+// the same node are counted as forwarding loops.
+class DropAccounting
+{
+  public:
+    enum Reason
+    {
+        NO_ROUTE,
+        TTL_EXPIRED,
+        INTERFACE_DOWN,
+        LINK_DOWN,
+        QUEUE_FULL,
+        OTHER,
+        LOOP, // Not a drop, a packet revisiting a node
+        REASONS
+    };
+
+    explicit DropAccounting(Time interval)
+        : m_interval(interval)
+    {
+        for (uint32_t i = 0; i < NodeList::GetNNodes(); ++i)
+        {
+            Ptr<Node> node = NodeList::GetNode(i);
+            auto state = std::make_unique<NodeState>();
+            state->accounting = this;
+            state->id = node->GetId();
+            state->name = Names::FindName(node);
+            Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>();
+            ipv4->TraceConnectWithoutContext("Drop",
+                                             MakeBoundCallback(&DropAccounting::Ipv4Drop,
+                                                               state.get()));
+            ipv4->TraceConnectWithoutContext("UnicastForward",
+                                             MakeBoundCallback(&DropAccounting::Forward,
+                                                               state.get()));
+            Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+            for (uint32_t j = 0; j < node->GetNDevices(); ++j)
+            {
+                Ptr<NetDevice> device = node->GetDevice(j);
+                auto deviceState = std::make_unique<DeviceState>();
+                deviceState->node = state.get();
+                deviceState->device = DynamicCast<CsmaNetDevice>(device);
+                if (deviceState->device)
+                {
+                    device->TraceConnectWithoutContext(
+                        "MacTxDrop",
+                        MakeBoundCallback(&DropAccounting::DeviceDrop, deviceState.get()));
+                    device->TraceConnectWithoutContext(
+                        "PhyRxDrop",
+                        MakeBoundCallback(&DropAccounting::DeviceRxDrop, deviceState.get()));
+                    state->devices.push_back(std::move(deviceState));
+                }
+                Ptr<QueueDisc> queueDisc = tc ? tc->GetRootQueueDiscOnDevice(device) : nullptr;
+                if (queueDisc)
+                {
+                    for (const char* trace : {"DropBeforeEnqueue", "DropAfterDequeue"})
+                    {
+                        queueDisc->TraceConnectWithoutContext(
+                            trace,
+                            MakeBoundCallback(&DropAccounting::QueueDiscDrop, state.get()));
+                    }
+                }
+            }
+            m_nodes.push_back(std::move(state));
+        }
+        Simulator::Schedule(Seconds(1), &DropAccounting::Expire, this);
+    }
+
+    void Write(const std::string& filename) const
+    {
+        std::ofstream out(filename);
+        out << "time,node,no_route,ttl_expired,interface_down,link_down,queue_full,other,loops\n";
+        for (const auto& node : m_nodes)
+        {
+            for (const auto& bucket : node->buckets)
+            {
+                out << (m_interval * bucket.first).GetSeconds() << "," << node->name;
+                for (uint32_t reason = 0; reason < REASONS; ++reason)
+                {
+                    out << "," << bucket.second[reason];
+                }
+                out << "\n";
+            }
+        }
+    }
+
+    // Total of one reason over all nodes and intervals.
+    uint64_t GetTotal(Reason reason) const
+    {
+        uint64_t total = 0;
+        for (const auto& node : m_nodes)
+        {
+            for (const auto& bucket : node->buckets)
+            {
+                total += bucket.second[reason];
+            }
+        }
+        return total;
+    }
+
+    void Report(std::ostream& os) const
+    {
+        static const char* names[REASONS] =
+            {"no route", "TTL expired", "interface down", "link down", "queue full", "other", "loops"};
+        for (const auto& node : m_nodes)
+        {
+            std::array<uint64_t, REASONS> total{};
+            for (const auto& bucket : node->buckets)
+            {
+                for (uint32_t reason = 0; reason < REASONS; ++reason)
+                {
+                    total[reason] += bucket.second[reason];
+                }
+            }
+            if (node->buckets.empty())
+            {
+                continue;
+            }
+            os << "Drops at " << node->name << ":";
+            for (uint32_t reason = 0; reason < REASONS; ++reason)
+            {
+                os << " " << names[reason] << " " << total[reason]
+                   << (reason + 1 < REASONS ? "," : "");
+            }
+            os << std::endl;
+        }
+    }
+
+  private:
+    struct DeviceState;
+
+    struct NodeState
+    {
+        DropAccounting* accounting;
+        uint32_t id;
+        std::string name;
+        std::vector<std::unique_ptr<DeviceState>> devices;
+        std::map<int64_t, std::array<uint64_t, REASONS>> buckets;
+    };
+
+    struct DeviceState
+    {
+        NodeState* node;
+        Ptr<CsmaNetDevice> device;
+    };
+
+    struct Visits
+    {
+        Time last;
+        std::vector<uint32_t> nodes;
+    };
+
+    void Count(NodeState* node, Reason reason)
+    {
+        auto& bucket = node->buckets[Div(Simulator::Now(), m_interval)];
+        bucket[reason]++;
+    }
+
+    static void Ipv4Drop(NodeState* node,
+                         const Ipv4Header&,
+                         Ptr<const Packet>,
+                         Ipv4L3Protocol::DropReason reason,
+                         Ptr<Ipv4>,
+                         uint32_t)
+    {
+        switch (reason)
+        {
+        case Ipv4L3Protocol::DROP_NO_ROUTE:
+            node->accounting->Count(node, NO_ROUTE);
+            break;
+        case Ipv4L3Protocol::DROP_TTL_EXPIRED:
+            node->accounting->Count(node, TTL_EXPIRED);
+            break;
+        case Ipv4L3Protocol::DROP_INTERFACE_DOWN:
+            node->accounting->Count(node, INTERFACE_DOWN);
+            break;
+        default:
+            node->accounting->Count(node, OTHER);
+            break;
+        }
+    }
+
+    // A CSMA device refuses frames when it is detached or sending is
+    // disabled, and otherwise only when its queue is full.
+    static void DeviceDrop(DeviceState* device, Ptr<const Packet>)
+    {
+        NodeState* node = device->node;
+        bool linkDown = !device->device->IsLinkUp() || !device->device->IsSendEnabled();
+        node->accounting->Count(node, linkDown ? LINK_DOWN : QUEUE_FULL);
+    }
+
+    // Received frames are dropped when receiving is disabled or by the
+    // error model of a silently failed link.
+    static void DeviceRxDrop(DeviceState* device, Ptr<const Packet> frame)
+    {
+        EthernetHeader ethernet;
+        frame->PeekHeader(ethernet);
+        if (ethernet.GetLengthType() == 0x0800)
+        {
+            device->node->accounting->Count(device->node, LINK_DOWN);
+        }
+    }
+
+    static void QueueDiscDrop(NodeState* node, Ptr<const QueueDiscItem>, const char* reason)
+    {
+        if (std::strcmp(reason, EMPTY_RIP_RESPONSE_DROP) != 0)
+        {
+            node->accounting->Count(node, QUEUE_FULL);
+        }
+    }
+
+    static void Forward(NodeState* node, const Ipv4Header&, Ptr<const Packet> packet, uint32_t)
+    {
+        DropAccounting* accounting = node->accounting;
+        Visits& visits = accounting->m_visits[packet->GetUid()];
+        visits.last = Simulator::Now();
+        if (std::find(visits.nodes.begin(), visits.nodes.end(), node->id) != visits.nodes.end())
+        {
+            accounting->Count(node, LOOP);
+        }
+        else
+        {
+            visits.nodes.push_back(node->id);
+        }
+    }
+
+    // Forget the path of packets that have not been forwarded for a second.
+    void Expire()
+    {
+        for (auto it = m_visits.begin(); it != m_visits.end();)
+        {
+            it = (Simulator::Now() - it->second.last > Seconds(1)) ? m_visits.erase(it) : ++it;
+        }
+        Simulator::Schedule(Seconds(1), &DropAccounting::Expire, this);
+    }
+
+    Time m_interval;
+    std::vector<std::unique_ptr<NodeState>> m_nodes;
+    std::map<uint64_t, Visits> m_visits; // Packet uid to visited nodes
+};
+
+} // namespace ns3
+
+#endif // RIP_ACCOUNTING_H
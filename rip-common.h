@@ -0,0 +1,270 @@
+// Helpers shared by rip-simple-network.cc, its watchers and its tests:
+// interface changes, RIP messages and the routing tables of every engine.
+
+#ifndef RIP_COMMON_H
+#define RIP_COMMON_H
+
+#include "ns3/core-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+// Queue disc drop reason of the RIP responses a rewriter left without
+// routes; these are not data plane drops.
+constexpr const char* EMPTY_RIP_RESPONSE_DROP = "Empty RIP response";
+
+// Called for every interface SetInterfaceState sets down or up
+inline std::vector<std::function<void(Ptr<Node>, uint32_t, bool)>> g_interfaceListeners;
+
+// Set an IPv4 interface down or up and tell the interface listeners.
+inline void SetInterfaceState(Ptr<Node> node, uint32_t interface, bool up)
+{
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    if (up)
+    {
+        ipv4->SetUp(interface);
+    }
+    else
+    {
+        ipv4->SetDown(interface);
+    }
+    for (const auto& listener : g_interfaceListeners)
+    {
+        listener(node, interface, up);
+    }
+}
+
+// Drop everything the device of an interface receives, or stop doing so.
+inline void SetLinkSilent(Ptr<Node> node, uint32_t interface, bool silent)
+{
+    Ptr<CsmaNetDevice> device =
+        DynamicCast<CsmaNetDevice>(node->GetObject<Ipv4>()->GetNetDevice(interface));
+    Ptr<RateErrorModel> errorModel;
+    if (silent)
+    {
+        errorModel = CreateObject<RateErrorModel>();
+        errorModel->SetUnit(RateErrorModel::ERROR_UNIT_PACKET);
+        errorModel->SetRate(1.0);
+    }
+    device->SetReceiveErrorModel(errorModel);
+}
+
+// The other IPv4 nodes on the link of an interface, with their addresses.
+inline std::vector<std::pair<Ptr<Node>, Ipv4Address>> GetLinkNeighbors(Ptr<Node> node, uint32_t interface)
+{
+    std::vector<std::pair<Ptr<Node>, Ipv4Address>> neighbors;
+    Ptr<NetDevice> device = node->GetObject<Ipv4>()->GetNetDevice(interface);
+    Ptr<Channel> channel = device->GetChannel();
+    for (std::size_t i = 0; i < channel->GetNDevices(); ++i)
+    {
+        Ptr<NetDevice> peer = channel->GetDevice(i);
+        Ptr<Ipv4> peerIpv4 = peer->GetNode()->GetObject<Ipv4>();
+        int32_t peerInterface = peerIpv4 ? peerIpv4->GetInterfaceForDevice(peer) : -1;
+        if (peer != device && peerInterface >= 0)
+        {
+            neighbors.emplace_back(peer->GetNode(), peerIpv4->GetAddress(peerInterface, 0).GetLocal());
+        }
+    }
+    return neighbors;
+}
+
+// Unicast a RIP message to a neighbor from the RIP port, so the neighbor's
+// Rip handles it and answers to the RIP port.
+inline void SendRipTo(Ptr<Node> node, uint32_t interface, Ipv4Address neighbor, const RipHeader& message)
+{
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    Ipv4Address local = ipv4->GetAddress(interface, 0).GetLocal();
+    UdpHeader udp;
+    udp.SetSourcePort(520);
+    udp.SetDestinationPort(520);
+    Ptr<Packet> packet = Create<Packet>();
+    packet->AddHeader(message);
+    packet->AddHeader(udp);
+
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(neighbor);
+    route->SetSource(local);
+    route->SetGateway(neighbor);
+    route->SetOutputDevice(ipv4->GetNetDevice(interface));
+    ipv4->Send(packet, local, neighbor, 17, route);
+}
+
+// Whether a packet without its IPv4 header is a RIP message. Every RIP
+// classifier and parser of the program checks this.
+inline bool IsRipPayload(const Ipv4Header& ip, Ptr<const Packet> payload)
+{
+    if (ip.GetProtocol() != 17 || payload->GetSize() < 8)
+    {
+        return false;
+    }
+    UdpHeader udp;
+    payload->PeekHeader(udp);
+    return udp.GetDestinationPort() == 520 || udp.GetSourcePort() == 520;
+}
+
+// Parse the RIP message of a packet that starts with its IPv4 header.
+inline bool ParseRip(Ptr<const Packet> packet, Ipv4Header& ip, RipHeader& rip)
+{
+    Ptr<Packet> copy = packet->Copy();
+    copy->RemoveHeader(ip);
+    if (!IsRipPayload(ip, copy))
+    {
+        return false;
+    }
+    UdpHeader udp;
+    copy->RemoveHeader(udp);
+    copy->RemoveHeader(rip);
+    return true;
+}
+
+// One valid route of a Rip instance.
+struct RipRoute
+{
+    Ipv4Address destination;
+    Ipv4Mask mask;
+    Ipv4Address gateway;
+    uint32_t metric{0};
+    uint32_t interface{0};
+};
+
+inline Ptr<Rip> GetRip(Ptr<Node> node)
+{
+    return Ipv4RoutingHelper::GetRouting<Rip>(node->GetObject<Ipv4>()->GetRoutingProtocol());
+}
+
+// Add networks on an interface Rip excludes, e.g. the stub networks of a
+// router, and have Rip announce them. Rip ignores the addresses added on
+// excluded interfaces, so the exclusion is lifted while they are added.
+inline void AddAnnouncedAddresses(Ptr<Node> node,
+                                  uint32_t interface,
+                                  const std::vector<Ipv4InterfaceAddress>& addresses)
+{
+    Ptr<Rip> rip = GetRip(node);
+    std::set<uint32_t> exclusions = rip->GetInterfaceExclusions();
+    std::set<uint32_t> announcing = exclusions;
+    announcing.erase(interface);
+    rip->SetInterfaceExclusions(announcing);
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    for (const auto& address : addresses)
+    {
+        ipv4->AddAddress(interface, address);
+    }
+    rip->SetInterfaceExclusions(exclusions);
+}
+
+inline Rip::SplitHorizonType_e GetSplitHorizon(Ptr<Rip> rip)
+{
+    EnumValue<Rip::SplitHorizonType_e> splitHorizon;
+    rip->GetAttribute("SplitHorizon", splitHorizon);
+    return splitHorizon.Get();
+}
+
+inline bool IsDottedQuad(const std::string& token)
+{
+    return !token.empty() && std::count(token.begin(), token.end(), '.') == 3 &&
+           token.find_first_not_of("0123456789.") == std::string::npos;
+}
+
+// Rip has no public accessor for its table, so the valid routes are read
+// back from Rip::PrintRoutingTable. Each route line is
+// "Destination Gateway Genmask Flags Metric Ref Use Iface".
+inline std::vector<RipRoute> CollectRipRoutes(Ptr<Rip> rip)
+{
+    std::ostringstream table;
+    rip->PrintRoutingTable(Create<OutputStreamWrapper>(&table));
+    std::vector<RipRoute> routes;
+    std::istringstream lines(table.str());
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        std::istringstream fields(line);
+        std::string destination;
+        std::string gateway;
+        std::string mask;
+        std::string flags;
+        std::string ref;
+        std::string use;
+        RipRoute route;
+        fields >> destination >> gateway >> mask >> flags >> route.metric >> ref >> use >>
+            route.interface;
+        if (!fields || !IsDottedQuad(destination) || !IsDottedQuad(gateway) ||
+            !IsDottedQuad(mask))
+        {
+            continue;
+        }
+        route.destination = Ipv4Address(destination.c_str());
+        route.gateway = Ipv4Address(gateway.c_str());
+        route.mask = Ipv4Mask(mask.c_str());
+        routes.push_back(route);
+    }
+    return routes;
+}
+
+inline RipRoute ToRipRoute(const Ipv4RoutingTableEntry& entry, uint32_t metric)
+{
+    RipRoute route;
+    route.destination = entry.GetDestNetwork();
+    route.mask = entry.GetDestNetworkMask();
+    route.gateway = entry.GetGateway();
+    route.metric = metric;
+    route.interface = entry.GetInterface();
+    return route;
+}
+
+// The routes of a router under any routing engine: Rip's valid routes, the
+// global routing table, or the static routes (SPF installs its routes
+// there). Global routing leaves the attached networks to the interfaces,
+// so they are added with metric 0.
+inline std::vector<RipRoute> CollectRoutes(Ptr<Node> node)
+{
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    if (Ptr<Rip> rip = GetRip(node))
+    {
+        return CollectRipRoutes(rip);
+    }
+    std::vector<RipRoute> routes;
+    if (Ptr<Ipv4GlobalRouting> global =
+            Ipv4RoutingHelper::GetRouting<Ipv4GlobalRouting>(ipv4->GetRoutingProtocol()))
+    {
+        for (uint32_t i = 1; i < ipv4->GetNInterfaces(); ++i)
+        {
+            for (uint32_t j = 0; ipv4->IsUp(i) && j < ipv4->GetNAddresses(i); ++j)
+            {
+                Ipv4InterfaceAddress address = ipv4->GetAddress(i, j);
+                RipRoute route;
+                route.destination = address.GetLocal().CombineMask(address.GetMask());
+                route.mask = address.GetMask();
+                route.interface = i;
+                routes.push_back(route);
+            }
+        }
+        for (uint32_t i = 0; i < global->GetNRoutes(); ++i)
+        {
+            routes.push_back(ToRipRoute(*global->GetRoute(i), 0));
+        }
+    }
+    if (Ptr<Ipv4StaticRouting> routing =
+            Ipv4RoutingHelper::GetRouting<Ipv4StaticRouting>(ipv4->GetRoutingProtocol()))
+    {
+        for (uint32_t i = 0; i < routing->GetNRoutes(); ++i)
+        {
+            routes.push_back(ToRipRoute(routing->GetRoute(i), routing->GetMetric(i)));
+        }
+    }
+    return routes;
+}
+
+} // namespace ns3
+
+#endif // RIP_COMMON_H
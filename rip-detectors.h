@@ -0,0 +1,591 @@
+// Convergence, count-to-infinity and RIP overhead measurements.
+
+#ifndef RIP_DETECTORS_H
+#define RIP_DETECTORS_H
+
+#include "rip-route-watcher.h"
+
+#include <array>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <tuple>
+
+namespace ns3
+{
+
+// Measures convergence after each topology event: when the last routing
+// table changed, and when every probe pair (ingress router, destination
+// address) had a loop-free path through the routing tables again. Works for
+// every routing engine the RouteWatcher follows.
+class ConvergenceDetector
+{
+  public:
+    ConvergenceDetector(RouteWatcher* watcher, const std::string& strategy)
+        : m_strategy(strategy)
+    {
+        for (uint32_t i = 0; i < NodeList::GetNNodes(); ++i)
+        {
+            Ptr<Ipv4> ipv4 = NodeList::GetNode(i)->GetObject<Ipv4>();
+            for (uint32_t j = 1; ipv4 && j < ipv4->GetNInterfaces(); ++j)
+            {
+                for (uint32_t k = 0; k < ipv4->GetNAddresses(j); ++k)
+                {
+                    m_addressOwner[ipv4->GetAddress(j, k).GetLocal().Get()] = i;
+                }
+            }
+        }
+        for (uint32_t router = 0; router < watcher->GetNRouters(); ++router)
+        {
+            m_routerOf[watcher->GetNode(router)->GetId()] = router;
+        }
+        m_routes.resize(watcher->GetNRouters());
+        watcher->AddListener([this](const RouteChange& change) { Changed(change); });
+    }
+
+    void AddProbe(Ptr<Node> ingress, Ipv4Address destination)
+    {
+        m_probes.emplace_back(m_routerOf.at(ingress->GetId()), destination);
+    }
+
+    // The RouteWatcher reports the table changes an event causes after the
+    // other events of that time, so they are attributed to the event.
+    void AddEvent(Time at, const std::string& description)
+    {
+        Simulator::Schedule(at, &ConvergenceDetector::Open, this, description);
+    }
+
+    // Worst table and path convergence over all events, and the number of
+    // events after which the paths were not restored.
+    void Summarize(double& worstTables, double& worstPaths, uint32_t& unrestored) const
+    {
+        worstTables = 0;
+        worstPaths = 0;
+        unrestored = 0;
+        for (const auto& event : m_events)
+        {
+            worstTables = std::max(worstTables, (event.lastChange - event.time).GetSeconds());
+            if (event.pathsLost && !event.restored)
+            {
+                unrestored++;
+            }
+            else if (event.pathsLost)
+            {
+                worstPaths = std::max(worstPaths, (event.pathsRestored - event.time).GetSeconds());
+            }
+        }
+    }
+
+    void Report(std::ostream& os) const
+    {
+        for (const auto& event : m_events)
+        {
+            os << "Convergence [" << m_strategy << "] " << event.description << " at "
+               << event.time.GetSeconds() << " s: tables settled after "
+               << (event.lastChange - event.time).GetSeconds() << " s, ";
+            if (!event.pathsLost)
+            {
+                os << "paths never lost";
+            }
+            else if (event.restored)
+            {
+                os << "paths restored after " << (event.pathsRestored - event.time).GetSeconds()
+                   << " s";
+            }
+            else
+            {
+                os << "paths not restored";
+            }
+            os << std::endl;
+        }
+    }
+
+  private:
+    struct Event
+    {
+        Time time;
+        std::string description;
+        Time lastChange;
+        bool pathsLost{false};
+        bool restored{false};
+        Time pathsRestored;
+    };
+
+    enum PathState
+    {
+        PATH_OK,
+        PATH_NO_ROUTE,
+        PATH_LOOP
+    };
+
+    void Open(std::string description)
+    {
+        Event event;
+        event.time = Simulator::Now();
+        event.description = description;
+        event.lastChange = event.time;
+        m_events.push_back(event);
+        // Evaluate once the RouteWatcher has looked at the tables
+        Simulator::ScheduleNow(&ConvergenceDetector::Evaluate, this);
+    }
+
+    void Changed(const RouteChange& change)
+    {
+        PrefixTrie<RipRoute>& routes = m_routes[change.router];
+        if (change.kind == RouteChange::REMOVE)
+        {
+            routes.Remove(change.before.destination, change.before.mask);
+        }
+        else
+        {
+            routes.Insert(change.after.destination, change.after.mask, change.after);
+        }
+        if (m_events.empty())
+        {
+            return;
+        }
+        m_events.back().lastChange = change.time;
+        Evaluate();
+    }
+
+    void Evaluate()
+    {
+        if (m_events.empty())
+        {
+            return;
+        }
+        Event& event = m_events.back();
+        bool allOk = true;
+        for (const auto& probe : m_probes)
+        {
+            allOk = allOk && Walk(probe.first, probe.second) == PATH_OK;
+        }
+        if (!allOk)
+        {
+            event.pathsLost = true;
+            event.restored = false;
+        }
+        else if (event.pathsLost && !event.restored)
+        {
+            event.restored = true;
+            event.pathsRestored = Simulator::Now();
+        }
+    }
+
+    // Follow the next hops of the routing tables from a router towards an address.
+    // The tables are kept in tries updated with every change, so a change is
+    // evaluated on the table it leads to.
+    PathState Walk(uint32_t router, Ipv4Address destination) const
+    {
+        std::set<uint32_t> visited;
+        while (visited.insert(router).second)
+        {
+            const RipRoute* best = m_routes[router].Lookup(destination);
+            if (!best)
+            {
+                return PATH_NO_ROUTE;
+            }
+            if (best->gateway == Ipv4Address::GetZero())
+            {
+                return PATH_OK;
+            }
+            auto owner = m_addressOwner.find(best->gateway.Get());
+            if (owner == m_addressOwner.end())
+            {
+                return PATH_NO_ROUTE;
+            }
+            auto next = m_routerOf.find(owner->second);
+            if (next == m_routerOf.end())
+            {
+                // The gateway is not a router, it delivers the packet itself
+                return PATH_OK;
+            }
+            router = next->second;
+        }
+        return PATH_LOOP;
+    }
+
+    std::string m_strategy;
+    std::map<uint32_t, uint32_t> m_addressOwner; // Address to node id
+    std::map<uint32_t, uint32_t> m_routerOf;     // Node id to RouteWatcher router
+    std::vector<PrefixTrie<RipRoute>> m_routes;  // By RouteWatcher router
+    std::vector<std::pair<uint32_t, Ipv4Address>> m_probes;
+    std::vector<Event> m_events;
+};
+
+// Detects count-to-infinity episodes: a router raising its metric for the
+// same prefix in successive updates, with less than a quiet interval between
+// the increases. A single increase, as after a normal reroute, is not an
+// episode. Episodes are accounted with their duration, number of increases
+// and the RIP responses (and their bytes) in which the router announced the
+// prefix meanwhile.
+class CountToInfinityDetector
+{
+  public:
+    CountToInfinityDetector(RouteWatcher* watcher, Time quiet, uint32_t minIncrements)
+        : m_watcher(watcher),
+          m_quiet(quiet),
+          m_minIncrements(minIncrements)
+    {
+        watcher->AddListener([this](const RouteChange& change) { Changed(change); });
+        for (uint32_t router = 0; router < watcher->GetNRouters(); ++router)
+        {
+            auto sender = std::make_unique<Sender>();
+            sender->detector = this;
+            sender->router = router;
+            watcher->GetNode(router)->GetObject<Ipv4L3Protocol>()->TraceConnectWithoutContext(
+                "Tx",
+                MakeBoundCallback(&CountToInfinityDetector::Sent, sender.get()));
+            m_senders.push_back(std::move(sender));
+        }
+    }
+
+    void Report(std::ostream& os)
+    {
+        for (auto& entry : m_open)
+        {
+            Close(entry.second);
+        }
+        m_open.clear();
+        os << "Count-to-infinity episodes: " << m_episodes.size() << std::endl;
+        for (const auto& episode : m_episodes)
+        {
+            os << "  " << m_watcher->GetName(episode.router) << " " << episode.destination << "/"
+               << episode.mask.GetPrefixLength() << " from " << episode.start.GetSeconds()
+               << " s for " << (episode.lastIncrease - episode.start).GetSeconds() << " s: "
+               << episode.increments << " metric increases up to " << episode.maxMetric
+               << (episode.reachedInfinity ? " (reached infinity)" : "") << ", "
+               << episode.updates << " updates, " << episode.bytes << " bytes" << std::endl;
+        }
+    }
+
+    uint32_t GetNEpisodes() const
+    {
+        return m_episodes.size();
+    }
+
+  private:
+    using EpisodeKey = std::tuple<uint32_t, uint32_t, uint32_t>; // Router, destination, mask
+
+    struct Episode
+    {
+        uint32_t router;
+        Ipv4Address destination;
+        Ipv4Mask mask;
+        Time start;
+        Time lastIncrease;
+        uint32_t increments{0};
+        uint32_t maxMetric{0};
+        bool reachedInfinity{false};
+        uint64_t updates{0};
+        uint64_t bytes{0};
+    };
+
+    struct Sender
+    {
+        CountToInfinityDetector* detector;
+        uint32_t router;
+    };
+
+    void Changed(const RouteChange& change)
+    {
+        const RipRoute& route = (change.kind == RouteChange::ADD) ? change.after : change.before;
+        EpisodeKey key(change.router, route.destination.Get(), route.mask.Get());
+        auto open = m_open.find(key);
+        if (open != m_open.end() && change.time - open->second.lastIncrease > m_quiet)
+        {
+            Close(open->second);
+            m_open.erase(open);
+            open = m_open.end();
+        }
+        if (change.kind == RouteChange::REMOVE)
+        {
+            if (open != m_open.end())
+            {
+                open->second.reachedInfinity = true;
+            }
+            return;
+        }
+        if (change.kind == RouteChange::ADD || change.after.metric <= change.before.metric)
+        {
+            return;
+        }
+        if (open == m_open.end())
+        {
+            Episode episode;
+            episode.router = change.router;
+            episode.destination = route.destination;
+            episode.mask = route.mask;
+            episode.start = change.time;
+            open = m_open.emplace(key, episode).first;
+        }
+        Episode& episode = open->second;
+        if (episode.increments > 0 && change.time == episode.lastIncrease)
+        {
+            return; // Same update round
+        }
+        episode.lastIncrease = change.time;
+        episode.increments++;
+        episode.maxMetric = std::max(episode.maxMetric, change.after.metric);
+        episode.reachedInfinity = episode.reachedInfinity || change.after.metric >= 16;
+    }
+
+    // Every RTE is charged its own 20 bytes and an equal share of the IPv4,
+    // UDP and RIP headers of the packet.
+    static void Sent(Sender* sender, Ptr<const Packet> packet, Ptr<Ipv4>, uint32_t)
+    {
+        CountToInfinityDetector* detector = sender->detector;
+        Ipv4Header ip;
+        RipHeader rip;
+        if (detector->m_open.empty() || !ParseRip(packet, ip, rip) ||
+            rip.GetCommand() != RipHeader::RESPONSE || rip.GetRteNumber() == 0)
+        {
+            return;
+        }
+        uint32_t rteBytes =
+            20 + (packet->GetSize() - 20 * rip.GetRteNumber()) / rip.GetRteNumber();
+        for (const auto& rte : rip.GetRteList())
+        {
+            auto open = detector->m_open.find(
+                EpisodeKey(sender->router, rte.GetPrefix().Get(), rte.GetSubnetMask().Get()));
+            if (open != detector->m_open.end())
+            {
+                open->second.updates++;
+                open->second.bytes += rteBytes;
+                if (rte.GetRouteMetric() >= 16)
+                {
+                    open->second.reachedInfinity = true;
+                }
+            }
+        }
+    }
+
+    void Close(const Episode& episode)
+    {
+        if (episode.increments >= m_minIncrements)
+        {
+            m_episodes.push_back(episode);
+        }
+    }
+
+    RouteWatcher* m_watcher;
+    Time m_quiet;
+    uint32_t m_minIncrements;
+    std::vector<std::unique_ptr<Sender>> m_senders;
+    std::map<EpisodeKey, Episode> m_open;
+    std::vector<Episode> m_episodes;
+};
+
+// RIP control plane overhead per router, interface and time interval.
+// Sent responses are split into solicited (unicast answers to a request),
+// periodic and triggered. Rip does not expose which timer sent a multicast
+// response, so the responses a router sends on an interface at one time are
+// classified by what they carry: periodic when they announce every valid
+// route Rip announces on that interface, as a full table update does, and
+// triggered when they only carry some of them. A triggered update in which
+// every route changed, e.g. at startup, counts as periodic.
+class RipOverhead
+{
+  public:
+    enum Counter
+    {
+        REQUESTS_TX,
+        PERIODIC_TX,
+        TRIGGERED_TX,
+        SOLICITED_TX,
+        RTES_TX,
+        BYTES_TX,
+        REQUESTS_RX,
+        RESPONSES_RX,
+        RTES_RX,
+        BYTES_RX,
+        COUNTERS
+    };
+
+    // Strategies maps node ids to the split horizon strategy of the router.
+    RipOverhead(const NodeContainer& routers,
+                Time interval,
+                const std::map<uint32_t, std::string>& strategies)
+        : m_interval(interval)
+    {
+        for (auto it = routers.Begin(); it != routers.End(); ++it)
+        {
+            auto router = std::make_unique<Router>();
+            router->overhead = this;
+            router->name = Names::FindName(*it);
+            router->strategy = strategies.at((*it)->GetId());
+            router->rip = GetRip(*it);
+            router->splitHorizon = GetSplitHorizon(router->rip);
+            Ptr<Ipv4L3Protocol> ipv4 = (*it)->GetObject<Ipv4L3Protocol>();
+            ipv4->TraceConnectWithoutContext("Tx",
+                                             MakeBoundCallback(&RipOverhead::Sent, router.get()));
+            ipv4->TraceConnectWithoutContext("Rx",
+                                             MakeBoundCallback(&RipOverhead::Received,
+                                                               router.get()));
+            m_routers.push_back(std::move(router));
+        }
+    }
+
+    void Write(const std::string& filename) const
+    {
+        std::ofstream out(filename);
+        out << "time,strategy,node,interface,requests_tx,periodic_tx,triggered_tx,solicited_tx,"
+               "rtes_tx,bytes_tx,requests_rx,responses_rx,rtes_rx,bytes_rx\n";
+        for (const auto& router : m_routers)
+        {
+            for (const auto& entry : router->bins)
+            {
+                out << (m_interval * entry.first.first).GetSeconds() << "," << router->strategy << ","
+                    << router->name << "," << entry.first.second;
+                for (uint64_t value : entry.second)
+                {
+                    out << "," << value;
+                }
+                out << "\n";
+            }
+        }
+    }
+
+    // Total of one counter over all routers, interfaces and intervals.
+    uint64_t GetTotal(Counter counter) const
+    {
+        uint64_t total = 0;
+        for (const auto& router : m_routers)
+        {
+            for (const auto& entry : router->bins)
+            {
+                total += entry.second[counter];
+            }
+        }
+        return total;
+    }
+
+    void Report(std::ostream& os) const
+    {
+        for (const auto& router : m_routers)
+        {
+            std::array<uint64_t, COUNTERS> total{};
+            for (const auto& entry : router->bins)
+            {
+                for (uint32_t counter = 0; counter < COUNTERS; ++counter)
+                {
+                    total[counter] += entry.second[counter];
+                }
+            }
+            os << "RIP overhead [" << router->strategy << "] " << router->name << ": sent "
+               << total[REQUESTS_TX] << " requests, " << total[PERIODIC_TX] << " periodic, "
+               << total[TRIGGERED_TX] << " triggered, " << total[SOLICITED_TX]
+               << " solicited responses, " << total[RTES_TX] << " routes, " << total[BYTES_TX]
+               << " bytes; received " << total[REQUESTS_RX] << " requests, "
+               << total[RESPONSES_RX] << " responses, " << total[RTES_RX] << " routes, "
+               << total[BYTES_RX] << " bytes" << std::endl;
+        }
+    }
+
+  private:
+    // Multicast responses sent on one interface at the current time
+    struct Burst
+    {
+        std::pair<int64_t, uint32_t> bin;
+        uint64_t packets{0};
+        std::set<std::pair<uint32_t, uint32_t>> missing; // Announced routes not carried yet
+    };
+
+    struct Router
+    {
+        RipOverhead* overhead;
+        std::string name;
+        std::string strategy;
+        Ptr<Rip> rip;
+        Rip::SplitHorizonType_e splitHorizon;
+        // (interval, interface) to counters
+        std::map<std::pair<int64_t, uint32_t>, std::array<uint64_t, COUNTERS>> bins;
+        std::map<uint32_t, Burst> bursts; // By interface
+    };
+
+    static std::array<uint64_t, COUNTERS>& Bin(Router* router, uint32_t interface)
+    {
+        int64_t bin = Div(Simulator::Now(), router->overhead->m_interval);
+        return router->bins[std::make_pair(bin, interface)];
+    }
+
+    static void Sent(Router* router, Ptr<const Packet> packet, Ptr<Ipv4>, uint32_t interface)
+    {
+        Ipv4Header ip;
+        RipHeader rip;
+        if (!ParseRip(packet, ip, rip))
+        {
+            return;
+        }
+        auto& bin = Bin(router, interface);
+        bin[BYTES_TX] += packet->GetSize();
+        if (rip.GetCommand() == RipHeader::REQUEST)
+        {
+            bin[REQUESTS_TX]++;
+            return;
+        }
+        bin[RTES_TX] += rip.GetRteNumber();
+        if (!ip.GetDestination().IsMulticast())
+        {
+            bin[SOLICITED_TX]++;
+            return;
+        }
+        Burst& burst = router->bursts[interface];
+        if (burst.packets == 0)
+        {
+            burst.bin = std::make_pair(Div(Simulator::Now(), router->overhead->m_interval), interface);
+            for (const auto& route : CollectRipRoutes(router->rip))
+            {
+                if (router->splitHorizon != Rip::SPLIT_HORIZON || route.interface != interface)
+                {
+                    burst.missing.emplace(route.destination.Get(), route.mask.Get());
+                }
+            }
+            // Rip sends all packets of an update in one event
+            Simulator::ScheduleNow(&RipOverhead::EndBurst, router, interface);
+        }
+        burst.packets++;
+        for (const auto& rte : rip.GetRteList())
+        {
+            burst.missing.erase(std::make_pair(rte.GetPrefix().Get(), rte.GetSubnetMask().Get()));
+        }
+    }
+
+    static void EndBurst(Router* router, uint32_t interface)
+    {
+        auto burst = router->bursts.find(interface);
+        Counter counter = burst->second.missing.empty() ? PERIODIC_TX : TRIGGERED_TX;
+        router->bins[burst->second.bin][counter] += burst->second.packets;
+        router->bursts.erase(burst);
+    }
+
+    static void Received(Router* router, Ptr<const Packet> packet, Ptr<Ipv4>, uint32_t interface)
+    {
+        Ipv4Header ip;
+        RipHeader rip;
+        if (!ParseRip(packet, ip, rip))
+        {
+            return;
+        }
+        auto& bin = Bin(router, interface);
+        bin[BYTES_RX] += packet->GetSize();
+        if (rip.GetCommand() == RipHeader::REQUEST)
+        {
+            bin[REQUESTS_RX]++;
+        }
+        else
+        {
+            bin[RESPONSES_RX]++;
+            bin[RTES_RX] += rip.GetRteNumber();
+        }
+    }
+
+    Time m_interval;
+    std::vector<std::unique_ptr<Router>> m_routers;
+};
+
+} // namespace ns3
+
+#endif // RIP_DETECTORS_H
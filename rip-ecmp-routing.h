@@ -0,0 +1,412 @@
+// Equal-cost multipath forwarding for the RIP routers.
+
+#ifndef RIP_ECMP_ROUTING_H
+#define RIP_ECMP_ROUTING_H
+
+#include "rip-route-watcher.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace ns3
+{
+
+// Equal-cost multipath forwarding on top of RIP. Rip keeps one next hop per
+// prefix, so this protocol, placed ahead of Rip in the list routing, learns
+// every neighbor's metric from the RIP responses the router receives (the
+// advertised metric plus the metric of the receiving interface) and
+// forwards unicast transit packets over all neighbors at the best metric,
+// one per flow by a hash of the 5-tuple. Packets sent by the router itself,
+// and destinations it has not learned, are left to Rip.
+class RipEcmpRouting : public Ipv4RoutingProtocol
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("RipSimpleRouting::RipEcmpRouting")
+                                .SetParent<Ipv4RoutingProtocol>()
+                                .SetGroupName("Internet")
+                                .AddConstructor<RipEcmpRouting>()
+                                .AddAttribute("Timeout",
+                                              "Time a learned next hop stays valid without updates",
+                                              TimeValue(Seconds(180)),
+                                              MakeTimeAccessor(&RipEcmpRouting::m_timeout),
+                                              MakeTimeChecker());
+        return tid;
+    }
+
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet>,
+                               const Ipv4Header&,
+                               Ptr<NetDevice>,
+                               Socket::SocketErrno& sockerr) override
+    {
+        sockerr = Socket::ERROR_NOROUTETOHOST;
+        return nullptr;
+    }
+
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback&,
+                    const LocalDeliverCallback&,
+                    const ErrorCallback&) override
+    {
+        Ipv4Address destination = header.GetDestination();
+        int32_t interface = m_ipv4->GetInterfaceForDevice(idev);
+        if (destination.IsMulticast() || destination.IsBroadcast() ||
+            !m_ipv4->IsForwarding(interface) || m_ipv4->IsDestinationAddress(destination, interface))
+        {
+            return false;
+        }
+        // Recompute drops a prefix without next hops, so a less specific
+        // prefix may match next and be stale as well
+        const PrefixKey* key = m_lookup.Lookup(destination);
+        while (key && Simulator::Now() >= m_prefixes.at(*key).nextExpiry)
+        {
+            Recompute(PrefixKey(*key));
+            key = m_lookup.Lookup(destination);
+        }
+        if (!key)
+        {
+            return false;
+        }
+        Prefix& prefix = m_prefixes.at(*key);
+        Ipv4Address gateway = prefix.best[FlowHash(p, header) % prefix.best.size()];
+        NextHop& hop = prefix.hops.at(gateway.Get());
+        hop.packets++;
+        hop.bytes += p->GetSize() + header.GetSerializedSize();
+
+        Ptr<Ipv4Route> route = Create<Ipv4Route>();
+        route->SetDestination(destination);
+        route->SetGateway(gateway);
+        route->SetSource(m_ipv4->GetAddress(hop.interface, 0).GetLocal());
+        route->SetOutputDevice(m_ipv4->GetNetDevice(hop.interface));
+        ucb(route, p, header);
+        return true;
+    }
+
+    void NotifyInterfaceUp(uint32_t) override
+    {
+    }
+
+    // Drop the next hops on the interface at once: the other equal-cost next
+    // hops keep forwarding while RIP reconverges.
+    void NotifyInterfaceDown(uint32_t interface) override
+    {
+        std::vector<PrefixKey> keys;
+        for (const auto& entry : m_prefixes)
+        {
+            keys.push_back(entry.first);
+        }
+        for (const auto& key : keys)
+        {
+            Prefix& prefix = m_prefixes.at(key);
+            uint32_t before = prefix.best.size();
+            bool lost = false;
+            for (auto it = prefix.hops.begin(); it != prefix.hops.end();)
+            {
+                if (it->second.interface == interface)
+                {
+                    lost = lost || std::find(prefix.best.begin(), prefix.best.end(),
+                                             Ipv4Address(it->first)) != prefix.best.end();
+                    Retire(key, it->first, it->second);
+                    it = prefix.hops.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            if (lost)
+            {
+                Failover failover{Simulator::Now(), interface, key, before, 0};
+                Recompute(key);
+                auto found = m_prefixes.find(key);
+                failover.remaining = (found == m_prefixes.end()) ? 0 : found->second.best.size();
+                m_failovers.push_back(failover);
+            }
+        }
+    }
+
+    void NotifyAddAddress(uint32_t, Ipv4InterfaceAddress) override
+    {
+    }
+
+    void NotifyRemoveAddress(uint32_t, Ipv4InterfaceAddress) override
+    {
+    }
+
+    void SetIpv4(Ptr<Ipv4> ipv4) override
+    {
+        m_ipv4 = ipv4;
+        m_seed = ipv4->GetObject<Node>()->GetId();
+        ipv4->TraceConnectWithoutContext("Rx", MakeCallback(&RipEcmpRouting::Received, this));
+    }
+
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override
+    {
+        std::ostream* os = stream->GetStream();
+        *os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: "
+            << Simulator::Now().As(unit) << ", ECMP routing table" << std::endl;
+        for (const auto& entry : m_prefixes)
+        {
+            *os << Ipv4Address(entry.first.first) << "/"
+                << Ipv4Mask(entry.first.second).GetPrefixLength() << " metric "
+                << entry.second.metric << " via";
+            for (const auto& gateway : entry.second.best)
+            {
+                *os << " " << gateway;
+            }
+            *os << std::endl;
+        }
+    }
+
+    // Best next hops for a destination, none if no prefix matches.
+    std::vector<Ipv4Address> GetNextHops(Ipv4Address destination) const
+    {
+        const PrefixKey* key = m_lookup.Lookup(destination);
+        return key ? m_prefixes.at(*key).best : std::vector<Ipv4Address>();
+    }
+
+    // Packets forwarded to a gateway over all prefixes.
+    uint64_t GetPackets(Ipv4Address gateway) const
+    {
+        uint64_t packets = 0;
+        for (const auto& prefix : m_prefixes)
+        {
+            auto hop = prefix.second.hops.find(gateway.Get());
+            packets += (hop == prefix.second.hops.end()) ? 0 : hop->second.packets;
+        }
+        for (const auto& counter : m_counters)
+        {
+            packets += (counter.first.second == gateway.Get()) ? counter.second.first : 0;
+        }
+        return packets;
+    }
+
+    void Report(std::ostream& os) const
+    {
+        std::string name = Names::FindName(m_ipv4->GetObject<Node>());
+        auto counters = m_counters;
+        for (const auto& prefix : m_prefixes)
+        {
+            for (const auto& hop : prefix.second.hops)
+            {
+                if (hop.second.packets > 0)
+                {
+                    auto& counter = counters[std::make_pair(prefix.first, hop.first)];
+                    counter.first += hop.second.packets;
+                    counter.second += hop.second.bytes;
+                }
+            }
+        }
+        for (const auto& entry : counters)
+        {
+            os << "ECMP " << name << ": " << Ipv4Address(entry.first.first.first) << "/"
+               << Ipv4Mask(entry.first.first.second).GetPrefixLength() << " via "
+               << Ipv4Address(entry.first.second) << ": " << entry.second.first << " packets, "
+               << entry.second.second << " bytes" << std::endl;
+        }
+        for (const auto& failover : m_failovers)
+        {
+            os << "ECMP " << name << ": interface " << failover.interface << " down at "
+               << failover.time.GetSeconds() << " s, " << Ipv4Address(failover.prefix.first)
+               << "/" << Ipv4Mask(failover.prefix.second).GetPrefixLength() << " keeps "
+               << failover.remaining << " of " << failover.before << " next hops" << std::endl;
+        }
+    }
+
+  private:
+    using PrefixKey = std::pair<uint32_t, uint32_t>; // Destination and mask
+
+    struct NextHop
+    {
+        uint32_t interface;
+        uint32_t metric;
+        Time expires;
+        uint64_t packets{0};
+        uint64_t bytes{0};
+    };
+
+    struct Prefix
+    {
+        std::map<uint32_t, NextHop> hops; // By gateway
+        uint32_t metric{16};
+        std::vector<Ipv4Address> best;
+        Time nextExpiry;
+    };
+
+    struct Failover
+    {
+        Time time;
+        uint32_t interface;
+        PrefixKey prefix;
+        uint32_t before;
+        uint32_t remaining;
+    };
+
+    void Received(Ptr<const Packet> packet, Ptr<Ipv4>, uint32_t interface)
+    {
+        Ipv4Header ip;
+        RipHeader rip;
+        if (!ParseRip(packet, ip, rip) || rip.GetCommand() != RipHeader::RESPONSE)
+        {
+            return;
+        }
+        for (const auto& rte : rip.GetRteList())
+        {
+            PrefixKey key(rte.GetPrefix().Get(), rte.GetSubnetMask().Get());
+            if (IsConnected(rte.GetPrefix(), rte.GetSubnetMask()))
+            {
+                continue;
+            }
+            uint32_t metric =
+                std::min<uint32_t>(rte.GetRouteMetric() + m_ipv4->GetMetric(interface), 16);
+            auto found = m_prefixes.find(key);
+            if (found == m_prefixes.end())
+            {
+                if (metric >= 16)
+                {
+                    continue;
+                }
+                found = m_prefixes.emplace(key, Prefix()).first;
+                m_lookup.Insert(rte.GetPrefix(), rte.GetSubnetMask(), key);
+            }
+            uint32_t gateway = ip.GetSource().Get();
+            auto hop = found->second.hops.find(gateway);
+            if (metric >= 16)
+            {
+                if (hop != found->second.hops.end())
+                {
+                    Retire(key, gateway, hop->second);
+                    found->second.hops.erase(hop);
+                }
+            }
+            else if (hop == found->second.hops.end())
+            {
+                found->second.hops.emplace(gateway,
+                                           NextHop{interface, metric, Simulator::Now() + m_timeout});
+            }
+            else
+            {
+                hop->second.interface = interface;
+                hop->second.metric = metric;
+                hop->second.expires = Simulator::Now() + m_timeout;
+            }
+            Recompute(key);
+        }
+    }
+
+    bool IsConnected(Ipv4Address prefix, Ipv4Mask mask) const
+    {
+        for (uint32_t i = 1; i < m_ipv4->GetNInterfaces(); ++i)
+        {
+            for (uint32_t j = 0; j < m_ipv4->GetNAddresses(i); ++j)
+            {
+                Ipv4InterfaceAddress address = m_ipv4->GetAddress(i, j);
+                if (address.GetMask().Get() == mask.Get() &&
+                    address.GetLocal().CombineMask(mask) == prefix)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Drop expired next hops and choose the best ones again; forget the
+    // prefix once no next hop is left.
+    void Recompute(const PrefixKey& key)
+    {
+        Prefix& prefix = m_prefixes.at(key);
+        Time now = Simulator::Now();
+        prefix.metric = 16;
+        prefix.nextExpiry = Time::Max();
+        for (auto it = prefix.hops.begin(); it != prefix.hops.end();)
+        {
+            if (it->second.expires <= now)
+            {
+                Retire(key, it->first, it->second);
+                it = prefix.hops.erase(it);
+                continue;
+            }
+            prefix.metric = std::min(prefix.metric, it->second.metric);
+            prefix.nextExpiry = std::min(prefix.nextExpiry, it->second.expires);
+            ++it;
+        }
+        prefix.best.clear();
+        for (const auto& hop : prefix.hops)
+        {
+            if (hop.second.metric == prefix.metric)
+            {
+                prefix.best.emplace_back(hop.first);
+            }
+        }
+        if (prefix.best.empty())
+        {
+            m_prefixes.erase(key);
+            m_lookup.Remove(Ipv4Address(key.first), Ipv4Mask(key.second));
+        }
+    }
+
+    // Keep the traffic counters of a next hop that goes away.
+    void Retire(const PrefixKey& key, uint32_t gateway, NextHop& hop)
+    {
+        if (hop.packets > 0)
+        {
+            auto& counters = m_counters[std::make_pair(key, gateway)];
+            counters.first += hop.packets;
+            counters.second += hop.bytes;
+            hop.packets = 0;
+            hop.bytes = 0;
+        }
+    }
+
+    // FNV-1a over addresses, protocol and ports (the ICMP identifier for
+    // ICMP), seeded per router so neighbors do not all pick the same path.
+    uint32_t FlowHash(Ptr<const Packet> p, const Ipv4Header& header) const
+    {
+        uint8_t ports[4] = {0, 0, 0, 0};
+        if ((header.GetProtocol() == 6 || header.GetProtocol() == 17) && p->GetSize() >= 4)
+        {
+            p->CopyData(ports, 4);
+        }
+        else if (header.GetProtocol() == 1 && p->GetSize() >= 6)
+        {
+            uint8_t icmp[6];
+            p->CopyData(icmp, 6);
+            ports[0] = icmp[4];
+            ports[1] = icmp[5];
+        }
+        uint32_t hash = 2166136261u ^ m_seed;
+        auto mix = [&hash](uint32_t value, uint32_t bytes) {
+            for (uint32_t i = 0; i < bytes; ++i)
+            {
+                hash = (hash ^ ((value >> (8 * i)) & 0xFF)) * 16777619u;
+            }
+        };
+        mix(header.GetSource().Get(), 4);
+        mix(header.GetDestination().Get(), 4);
+        mix(header.GetProtocol(), 1);
+        mix(ports[0] | (ports[1] << 8) | (ports[2] << 16) | (static_cast<uint32_t>(ports[3]) << 24),
+            4);
+        return hash;
+    }
+
+    Ptr<Ipv4> m_ipv4;
+    uint32_t m_seed{0};
+    Time m_timeout;
+    std::map<PrefixKey, Prefix> m_prefixes;
+    PrefixTrie<PrefixKey> m_lookup;
+    std::vector<Failover> m_failovers;
+    // Packets and bytes of retired next hops, by prefix and gateway
+    std::map<std::pair<PrefixKey, uint32_t>, std::pair<uint64_t, uint64_t>> m_counters;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(RipEcmpRouting);
+
+} // namespace ns3
+
+#endif // RIP_ECMP_ROUTING_H
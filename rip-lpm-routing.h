@@ -0,0 +1,331 @@
+// Longest prefix match forwarding of the RIP routes.
+
+#ifndef RIP_LPM_ROUTING_H
+#define RIP_LPM_ROUTING_H
+
+#include "rip-route-watcher.h"
+
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+// Forwarding through a prefix trie of the RIP table. Rip looks up every
+// packet in a linear scan of its routes; this protocol, placed ahead of Rip
+// in the list routing, keeps the same routes in a PrefixTrie. It learns them
+// as Rip does, from the RTEs of the responses the router receives and from
+// its interfaces, so every RTE costs one trie update and nothing rescans
+// the table. Destinations without a route, and multicast, are left to Rip.
+class RipLpmRouting : public Ipv4RoutingProtocol
+{
+  public:
+    // A route as Rip keeps it; connected networks have no gateway and no
+    // timeout.
+    struct Route
+    {
+        Ipv4Address gateway;
+        uint32_t interface{0};
+        uint32_t metric{0};
+        EventId timeout;
+    };
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("RipSimpleRouting::RipLpmRouting")
+                                .SetParent<Ipv4RoutingProtocol>()
+                                .SetGroupName("Internet")
+                                .AddConstructor<RipLpmRouting>();
+        return tid;
+    }
+
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet>,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override
+    {
+        sockerr = Socket::ERROR_NOROUTETOHOST;
+        Ipv4Address destination = header.GetDestination();
+        if (destination.IsMulticast() || destination.IsBroadcast())
+        {
+            return nullptr;
+        }
+        const Route* found = m_routes.Lookup(destination);
+        if (!found || !m_ipv4->IsUp(found->interface) ||
+            (oif && oif != m_ipv4->GetNetDevice(found->interface)))
+        {
+            return nullptr;
+        }
+        sockerr = Socket::ERROR_NOTERROR;
+        m_sent++;
+        return MakeRoute(destination, *found);
+    }
+
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback&,
+                    const LocalDeliverCallback&,
+                    const ErrorCallback&) override
+    {
+        Ipv4Address destination = header.GetDestination();
+        int32_t interface = m_ipv4->GetInterfaceForDevice(idev);
+        if (destination.IsMulticast() || destination.IsBroadcast() ||
+            !m_ipv4->IsForwarding(interface) || m_ipv4->IsDestinationAddress(destination, interface))
+        {
+            return false;
+        }
+        const Route* found = m_routes.Lookup(destination);
+        if (!found || !m_ipv4->IsUp(found->interface))
+        {
+            return false;
+        }
+        m_forwarded++;
+        ucb(MakeRoute(destination, *found), p, header);
+        return true;
+    }
+
+    void NotifyInterfaceUp(uint32_t interface) override
+    {
+        AddConnected(interface);
+    }
+
+    // Rip invalidates every route over the interface
+    void NotifyInterfaceDown(uint32_t interface) override
+    {
+        std::vector<std::pair<Ipv4Address, Ipv4Mask>> lost;
+        m_routes.ForEach([interface, &lost](Ipv4Address prefix, Ipv4Mask mask, const Route& route) {
+            if (route.interface == interface)
+            {
+                lost.emplace_back(prefix, mask);
+            }
+        });
+        for (const auto& prefix : lost)
+        {
+            Invalidate(prefix.first, prefix.second);
+        }
+    }
+
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override
+    {
+        if (m_ipv4->IsUp(interface) && address.GetScope() == Ipv4InterfaceAddress::GLOBAL &&
+            !GetRipInstance()->GetInterfaceExclusions().count(interface))
+        {
+            AddConnected(interface, address);
+        }
+    }
+
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override
+    {
+        Ipv4Address prefix = address.GetLocal().CombineMask(address.GetMask());
+        const Route* route = m_routes.Find(prefix, address.GetMask());
+        if (m_ipv4->IsUp(interface) && route && route->interface == interface)
+        {
+            Invalidate(prefix, address.GetMask());
+        }
+    }
+
+    // Also picks up the interfaces configured before the protocol was added
+    void SetIpv4(Ptr<Ipv4> ipv4) override
+    {
+        m_ipv4 = ipv4;
+        ipv4->TraceConnectWithoutContext("Rx", MakeCallback(&RipLpmRouting::Received, this));
+        for (uint32_t interface = 0; interface < ipv4->GetNInterfaces(); ++interface)
+        {
+            if (ipv4->IsUp(interface))
+            {
+                AddConnected(interface);
+            }
+        }
+    }
+
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override
+    {
+        *stream->GetStream() << "Node: " << m_ipv4->GetObject<Node>()->GetId()
+                             << ", Time: " << Simulator::Now().As(unit)
+                             << ", LPM routing table with " << m_routes.GetSize()
+                             << " routes of the RIP table" << std::endl;
+    }
+
+    // Apply the RTEs of a response from a neighbor with Rip's rules: a
+    // better metric replaces the route, the current gateway refreshes or
+    // changes it, and an equal metric from another gateway only takes over
+    // a route that is half way to its timeout.
+    void HandleResponse(const RipHeader& response, Ipv4Address sender, uint32_t interface)
+    {
+        Ptr<Rip> rip = GetRipInstance();
+        for (const auto& rte : response.GetRteList())
+        {
+            if (rte.GetRouteMetric() == 0 || rte.GetRouteMetric() > 16)
+            {
+                return; // Rip drops the whole message
+            }
+        }
+        uint32_t interfaceMetric = rip->GetInterfaceMetric(interface);
+        for (const auto& rte : response.GetRteList())
+        {
+            Ipv4Mask mask = rte.GetSubnetMask();
+            Ipv4Address prefix = rte.GetPrefix().CombineMask(mask);
+            uint32_t metric = std::min<uint32_t>(rte.GetRouteMetric() + interfaceMetric, 16);
+            Route* route = m_routes.Find(prefix, mask);
+            if (!route)
+            {
+                if (metric < 16)
+                {
+                    m_routes.Insert(prefix, mask, Route{sender, interface, metric, EventId()});
+                    Refresh(prefix, mask, *m_routes.Find(prefix, mask));
+                }
+            }
+            else if (metric < route->metric ||
+                     (metric == route->metric && route->gateway != sender &&
+                      Simulator::GetDelayLeft(route->timeout) < m_timeout / 2))
+            {
+                route->gateway = sender;
+                route->interface = interface;
+                route->metric = metric;
+                Refresh(prefix, mask, *route);
+            }
+            else if (route->gateway == sender && metric < 16)
+            {
+                route->metric = metric;
+                Refresh(prefix, mask, *route);
+            }
+            else if (route->gateway == sender)
+            {
+                Invalidate(prefix, mask);
+            }
+        }
+    }
+
+    const Route* GetRoute(Ipv4Address prefix, Ipv4Mask mask) const
+    {
+        return m_routes.Find(prefix, mask);
+    }
+
+    // The routes in the form CollectRipRoutes reads them from Rip.
+    std::vector<RipRoute> GetRoutes() const
+    {
+        std::vector<RipRoute> routes;
+        m_routes.ForEach([&routes](Ipv4Address prefix, Ipv4Mask mask, const Route& route) {
+            routes.push_back(RipRoute{prefix, mask, route.gateway, route.metric, route.interface});
+        });
+        return routes;
+    }
+
+    uint32_t GetNRoutes() const
+    {
+        return m_routes.GetSize();
+    }
+
+    uint64_t GetNForwarded() const
+    {
+        return m_forwarded;
+    }
+
+    void Report(std::ostream& os) const
+    {
+        os << "LPM " << Names::FindName(m_ipv4->GetObject<Node>()) << ": " << m_forwarded
+           << " packets forwarded, " << m_sent << " sent, " << m_routes.GetSize() << " routes"
+           << std::endl;
+    }
+
+  protected:
+    void DoDispose() override
+    {
+        m_routes.ForEach([](Ipv4Address, Ipv4Mask, const Route& route) {
+            Simulator::Cancel(route.timeout);
+        });
+        m_routes = PrefixTrie<Route>();
+        m_rip = nullptr;
+        m_ipv4 = nullptr;
+        Ipv4RoutingProtocol::DoDispose();
+    }
+
+  private:
+    // Rip only handles responses from other routers on its interfaces
+    void Received(Ptr<const Packet> packet, Ptr<Ipv4>, uint32_t interface)
+    {
+        Ipv4Header ip;
+        RipHeader rip;
+        if (!ParseRip(packet, ip, rip) || rip.GetCommand() != RipHeader::RESPONSE ||
+            m_ipv4->GetInterfaceForAddress(ip.GetSource()) >= 0 ||
+            GetRipInstance()->GetInterfaceExclusions().count(interface))
+        {
+            return;
+        }
+        HandleResponse(rip, ip.GetSource(), interface);
+    }
+
+    Ptr<Rip> GetRipInstance()
+    {
+        if (!m_rip)
+        {
+            m_rip = GetRip(m_ipv4->GetObject<Node>());
+            NS_ABORT_MSG_IF(!m_rip, "RipLpmRouting needs Rip in the list routing of its node");
+            TimeValue timeout;
+            m_rip->GetAttribute("TimeoutDelay", timeout);
+            m_timeout = timeout.Get();
+        }
+        return m_rip;
+    }
+
+    void AddConnected(uint32_t interface)
+    {
+        for (uint32_t i = 0; i < m_ipv4->GetNAddresses(interface); ++i)
+        {
+            Ipv4InterfaceAddress address = m_ipv4->GetAddress(interface, i);
+            if (address.GetScope() == Ipv4InterfaceAddress::GLOBAL)
+            {
+                AddConnected(interface, address);
+            }
+        }
+    }
+
+    void AddConnected(uint32_t interface, Ipv4InterfaceAddress address)
+    {
+        Ipv4Address prefix = address.GetLocal().CombineMask(address.GetMask());
+        Invalidate(prefix, address.GetMask());
+        m_routes.Insert(prefix, address.GetMask(), Route{Ipv4Address(), interface, 1, EventId()});
+    }
+
+    void Refresh(Ipv4Address prefix, Ipv4Mask mask, Route& route)
+    {
+        route.timeout.Cancel();
+        route.timeout =
+            Simulator::Schedule(m_timeout, &RipLpmRouting::Invalidate, this, prefix, mask);
+    }
+
+    void Invalidate(Ipv4Address prefix, Ipv4Mask mask)
+    {
+        Route* route = m_routes.Find(prefix, mask);
+        if (route)
+        {
+            route->timeout.Cancel();
+            m_routes.Remove(prefix, mask);
+        }
+    }
+
+    Ptr<Ipv4Route> MakeRoute(Ipv4Address destination, const Route& found)
+    {
+        Ptr<Ipv4Route> route = Create<Ipv4Route>();
+        route->SetDestination(destination);
+        route->SetGateway(found.gateway);
+        route->SetSource(m_ipv4->GetAddress(found.interface, 0).GetLocal());
+        route->SetOutputDevice(m_ipv4->GetNetDevice(found.interface));
+        return route;
+    }
+
+    Ptr<Ipv4> m_ipv4;
+    Ptr<Rip> m_rip;
+    Time m_timeout;
+    PrefixTrie<Route> m_routes;
+    uint64_t m_forwarded{0};
+    uint64_t m_sent{0};
+};
+
+NS_OBJECT_ENSURE_REGISTERED(RipLpmRouting);
+
+} // namespace ns3
+
+#endif // RIP_LPM_ROUTING_H
@@ -0,0 +1,192 @@
+// Pacing of the RIP packets a router sends.
+
+#ifndef RIP_PACING_H
+#define RIP_PACING_H
+
+#include "rip-common.h"
+
+#include "ns3/traffic-control-module.h"
+
+#include <functional>
+#include <vector>
+
+namespace ns3
+{
+
+// Root queue disc of the router interfaces that paces RIP. Rip sends all
+// messages of a multi-packet update at once; here each message after the
+// first leaves the interface at least Gap plus a random part of Jitter
+// after the one before it, while other packets keep flowing in between. A
+// RIP message queued alone, like a request or a single-packet update,
+// leaves at once. Rewriters may change the routes of the RIP responses
+// before they are queued, e.g. to summarize them.
+class RipPacingQueueDisc : public QueueDisc
+{
+  public:
+    using Rewriter = std::function<void(RipHeader& response)>;
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("RipSimpleRouting::RipPacingQueueDisc")
+                .SetParent<QueueDisc>()
+                .SetGroupName("TrafficControl")
+                .AddConstructor<RipPacingQueueDisc>()
+                .AddAttribute("MaxSize",
+                              "Max packets queued in the queue disc",
+                              QueueSizeValue(QueueSize("1000p")),
+                              MakeQueueSizeAccessor(&QueueDisc::SetMaxSize, &QueueDisc::GetMaxSize),
+                              MakeQueueSizeChecker())
+                .AddAttribute("Gap",
+                              "Minimum time between two RIP packets",
+                              TimeValue(MilliSeconds(10)),
+                              MakeTimeAccessor(&RipPacingQueueDisc::m_gap),
+                              MakeTimeChecker())
+                .AddAttribute("Jitter",
+                              "Maximum random time added to the gap",
+                              TimeValue(MilliSeconds(5)),
+                              MakeTimeAccessor(&RipPacingQueueDisc::m_jitter),
+                              MakeTimeChecker());
+        return tid;
+    }
+
+    RipPacingQueueDisc()
+        : QueueDisc(QueueDiscSizePolicy::MULTIPLE_QUEUES, QueueSizeUnit::PACKETS),
+          m_random(CreateObject<UniformRandomVariable>())
+    {
+    }
+
+    void AddRewriter(Rewriter rewriter)
+    {
+        m_rewriters.push_back(std::move(rewriter));
+    }
+
+  private:
+    static const uint32_t RIP_QUEUE = 0;
+    static const uint32_t OTHER_QUEUE = 1;
+
+    bool DoEnqueue(Ptr<QueueDiscItem> item) override
+    {
+        if (GetCurrentSize() >= GetMaxSize())
+        {
+            DropBeforeEnqueue(item, LIMIT_EXCEEDED_DROP);
+            return false;
+        }
+        Ptr<Ipv4QueueDiscItem> ipv4Item = DynamicCast<Ipv4QueueDiscItem>(item);
+        bool rip = ipv4Item && IsRipPayload(ipv4Item->GetHeader(), item->GetPacket());
+        // A message of a new update follows no other one unless an earlier
+        // update is still being paced out
+        if (rip)
+        {
+            if (Simulator::Now() != m_lastRip && !GetInternalQueue(RIP_QUEUE)->Peek())
+            {
+                m_nextRip = Simulator::Now();
+            }
+            m_lastRip = Simulator::Now();
+        }
+        if (rip && !m_rewriters.empty())
+        {
+            item = Rewrite(ipv4Item);
+            if (!item)
+            {
+                DropBeforeEnqueue(ipv4Item, EMPTY_RIP_RESPONSE_DROP);
+                return false;
+            }
+        }
+        return GetInternalQueue(rip ? RIP_QUEUE : OTHER_QUEUE)->Enqueue(item);
+    }
+
+    // The item with the response as the rewriters left it, nullptr when it
+    // has no routes left. The payload copy keeps the packet uid.
+    Ptr<QueueDiscItem> Rewrite(Ptr<Ipv4QueueDiscItem> item)
+    {
+        Ptr<Packet> payload = item->GetPacket()->Copy();
+        UdpHeader original;
+        payload->RemoveHeader(original);
+        RipHeader response;
+        payload->RemoveHeader(response);
+        if (response.GetCommand() != RipHeader::RESPONSE)
+        {
+            return item;
+        }
+        for (const auto& rewriter : m_rewriters)
+        {
+            rewriter(response);
+        }
+        if (response.GetRteNumber() == 0)
+        {
+            return nullptr;
+        }
+        // A fresh UDP header takes the length of the new payload
+        UdpHeader udp;
+        udp.SetSourcePort(original.GetSourcePort());
+        udp.SetDestinationPort(original.GetDestinationPort());
+        payload->AddHeader(response);
+        payload->AddHeader(udp);
+        Ipv4Header header = item->GetHeader();
+        header.SetPayloadSize(payload->GetSize());
+        return Create<Ipv4QueueDiscItem>(payload, item->GetAddress(), item->GetProtocol(), header);
+    }
+
+    Ptr<QueueDiscItem> DoDequeue() override
+    {
+        if (GetInternalQueue(RIP_QUEUE)->Peek())
+        {
+            Time now = Simulator::Now();
+            if (now >= m_nextRip)
+            {
+                m_nextRip = now + m_gap + Seconds(m_random->GetValue(0, m_jitter.GetSeconds()));
+                return GetInternalQueue(RIP_QUEUE)->Dequeue();
+            }
+            if (!m_wakeup.IsPending())
+            {
+                m_wakeup = Simulator::Schedule(m_nextRip - now, &RipPacingQueueDisc::Run, this);
+            }
+        }
+        return GetInternalQueue(OTHER_QUEUE)->Dequeue();
+    }
+
+    bool CheckConfig() override
+    {
+        if (GetNQueueDiscClasses() > 0 || GetNPacketFilters() > 0)
+        {
+            NS_LOG_ERROR("RipPacingQueueDisc has no classes nor packet filters");
+            return false;
+        }
+        if (GetNInternalQueues() == 0)
+        {
+            for (uint32_t i = 0; i < 2; ++i)
+            {
+                AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem>>(
+                    "MaxSize",
+                    QueueSizeValue(GetMaxSize())));
+            }
+        }
+        return GetNInternalQueues() == 2;
+    }
+
+    void InitializeParams() override
+    {
+    }
+
+    void DoDispose() override
+    {
+        m_wakeup.Cancel();
+        m_rewriters.clear();
+        QueueDisc::DoDispose();
+    }
+
+    Time m_gap;
+    Time m_jitter;
+    Ptr<UniformRandomVariable> m_random;
+    Time m_nextRip;
+    Time m_lastRip{Seconds(-1)}; // When the last RIP message was queued
+    EventId m_wakeup;            // Resumes dequeuing once the next RIP message may leave
+    std::vector<Rewriter> m_rewriters;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(RipPacingQueueDisc);
+
+} // namespace ns3
+
+#endif // RIP_PACING_H
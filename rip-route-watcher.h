@@ -0,0 +1,618 @@
+// Route change tracking of all routers, and the prefix trie used to look
+// up the tracked tables.
+
+#ifndef RIP_ROUTE_WATCHER_H
+#define RIP_ROUTE_WATCHER_H
+
+#include "rip-common.h"
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+
+namespace ns3
+{
+
+// A change of one route in one router's RIP table.
+struct RouteChange
+{
+    enum Kind
+    {
+        ADD,
+        REMOVE,
+        METRIC,
+        NEXT_HOP
+    };
+
+    Time time;
+    uint32_t router;
+    Kind kind;
+    RipRoute before; // Not set for ADD
+    RipRoute after;  // Not set for REMOVE
+};
+
+inline const char* RouteChangeKindName(RouteChange::Kind kind)
+{
+    switch (kind)
+    {
+    case RouteChange::ADD:
+        return "add";
+    case RouteChange::REMOVE:
+        return "remove";
+    case RouteChange::METRIC:
+        return "metric";
+    case RouteChange::NEXT_HOP:
+        return "nexthop";
+    }
+    return "unknown";
+}
+
+// Follows the routing tables of all routers and reports every route change.
+// Rip has no trace sources for its table, so the watcher keeps a copy of
+// every table and applies Rip's response rules to each RTE a router
+// receives. The table is only read back, right after Rip handled the packet,
+// when an RTE can change it; RTEs that merely refresh a route restart its
+// timeout here as in Rip, so timeouts are checked at the exact time Rip
+// expires the route. Interface changes arrive through g_interfaceListeners;
+// they are the only changes of the global, SPF and static tables.
+// Only valid routes are followed, garbage collection is not visible.
+class RouteWatcher
+{
+  public:
+    using RouteKey = std::pair<uint32_t, uint32_t>; // Destination and mask
+    using Table = std::map<RouteKey, RipRoute>;
+    using Listener = std::function<void(const RouteChange&)>;
+
+    // A positive poll interval additionally reads every table that often.
+    RouteWatcher(const NodeContainer& routers, Time pollInterval)
+        : m_pollInterval(pollInterval)
+    {
+        for (auto it = routers.Begin(); it != routers.End(); ++it)
+        {
+            auto router = std::make_unique<Router>();
+            router->watcher = this;
+            router->index = m_routers.size();
+            router->node = *it;
+            router->name = Names::FindName(*it);
+            router->rip = GetRip(*it);
+            if (router->rip)
+            {
+                router->exclusions = router->rip->GetInterfaceExclusions();
+                TimeValue timeout;
+                router->rip->GetAttribute("TimeoutDelay", timeout);
+                router->timeout = timeout.Get();
+                (*it)->GetObject<Ipv4L3Protocol>()->TraceConnectWithoutContext(
+                    "Rx",
+                    MakeBoundCallback(&RouteWatcher::Received, router.get()));
+            }
+            m_routerOf[(*it)->GetId()] = router.get();
+            m_routers.push_back(std::move(router));
+        }
+        g_interfaceListeners.push_back(
+            [this](Ptr<Node> node, uint32_t, bool) { InterfaceChanged(node); });
+        // Rip adds its connected routes when the nodes are initialized
+        Simulator::ScheduleNow(&RouteWatcher::CheckAll, this);
+        if (m_pollInterval.IsStrictlyPositive())
+        {
+            Simulator::Schedule(m_pollInterval, &RouteWatcher::Poll, this);
+        }
+    }
+
+    // Write every change as a CSV line to the given file.
+    void WriteTo(const std::string& filename)
+    {
+        m_out.open(filename);
+        m_out << "time,node,change,prefix,old_gateway,new_gateway,old_metric,new_metric\n";
+    }
+
+    void AddListener(Listener listener)
+    {
+        m_listeners.push_back(std::move(listener));
+    }
+
+    uint32_t GetNRouters() const
+    {
+        return m_routers.size();
+    }
+
+    Ptr<Node> GetNode(uint32_t router) const
+    {
+        return m_routers[router]->node;
+    }
+
+    const std::string& GetName(uint32_t router) const
+    {
+        return m_routers[router]->name;
+    }
+
+    const Table& GetTable(uint32_t router) const
+    {
+        return m_routers[router]->table;
+    }
+
+    void CheckAll()
+    {
+        for (auto& router : m_routers)
+        {
+            Check(router.get());
+        }
+    }
+
+  private:
+    struct Router
+    {
+        RouteWatcher* watcher;
+        uint32_t index;
+        Ptr<Node> node;
+        std::string name;
+        Ptr<Rip> rip; // nullptr under the other routing engines
+        std::set<uint32_t> exclusions;
+        Time timeout;
+        Table table;
+        std::map<RouteKey, Time> expiry; // Of the learned routes, when Rip times them out
+        EventId expiryCheck;
+        bool pending{false};
+    };
+
+    static void Received(Router* router, Ptr<const Packet> packet, Ptr<Ipv4>, uint32_t interface)
+    {
+        Ipv4Header ip;
+        RipHeader rip;
+        if (!ParseRip(packet, ip, rip) || rip.GetCommand() != RipHeader::RESPONSE ||
+            router->exclusions.count(interface) > 0)
+        {
+            return;
+        }
+        std::list<RipRte> rtes = rip.GetRteList();
+        for (const auto& rte : rtes)
+        {
+            if (rte.GetRouteMetric() == 0 || rte.GetRouteMetric() > 16)
+            {
+                return; // Rip ignores the whole message
+            }
+        }
+        // Rip handles the packet later in this same event, with these rules.
+        Time now = Simulator::Now();
+        uint32_t interfaceMetric = router->rip->GetInterfaceMetric(interface);
+        bool changes = false;
+        for (const auto& rte : rtes)
+        {
+            Ipv4Mask mask = rte.GetSubnetMask();
+            RouteKey key(rte.GetPrefix().CombineMask(mask).Get(), mask.Get());
+            uint32_t metric = std::min<uint32_t>(rte.GetRouteMetric() + interfaceMetric, 16);
+            auto found = router->table.find(key);
+            if (found == router->table.end())
+            {
+                changes = changes || metric < 16;
+                continue;
+            }
+            const RipRoute& route = found->second;
+            bool sameGateway = ip.GetSource() == route.gateway;
+            auto expiry = router->expiry.find(key);
+            Time left = (expiry == router->expiry.end()) ? Time() : expiry->second - now;
+            if (metric < route.metric || (metric > route.metric && sameGateway) ||
+                (metric == route.metric && !sameGateway && left < router->timeout / 2))
+            {
+                changes = true;
+            }
+            else if (metric == route.metric && sameGateway && expiry != router->expiry.end())
+            {
+                expiry->second = now + router->timeout;
+            }
+        }
+        if (changes && !router->pending)
+        {
+            router->pending = true;
+            Simulator::ScheduleNow(&RouteWatcher::Check, router->watcher, router);
+        }
+    }
+
+    void InterfaceChanged(Ptr<Node> node)
+    {
+        auto found = m_routerOf.find(node->GetId());
+        if (found != m_routerOf.end() && !found->second->pending)
+        {
+            // Look after the other events of this time, e.g. the one the
+            // ConvergenceDetector opens for a scheduled link failure
+            found->second->pending = true;
+            Simulator::ScheduleNow(&RouteWatcher::Check, this, found->second);
+        }
+    }
+
+    // Rip's timeout event for the earliest expiry was scheduled before this
+    // one, so look at the table once it has run.
+    void ExpiryDue(Router* router)
+    {
+        Simulator::ScheduleNow(&RouteWatcher::CheckExpired, this, router);
+    }
+
+    void CheckExpired(Router* router)
+    {
+        Time now = Simulator::Now();
+        for (const auto& entry : router->expiry)
+        {
+            if (entry.second <= now)
+            {
+                Check(router);
+                break;
+            }
+        }
+        ScheduleExpiryCheck(router);
+    }
+
+    void ScheduleExpiryCheck(Router* router)
+    {
+        if (router->expiryCheck.IsPending() || router->expiry.empty())
+        {
+            return;
+        }
+        Time next = Time::Max();
+        for (const auto& entry : router->expiry)
+        {
+            next = std::min(next, entry.second);
+        }
+        router->expiryCheck = Simulator::Schedule(next - Simulator::Now(),
+                                                  &RouteWatcher::ExpiryDue,
+                                                  this,
+                                                  router);
+    }
+
+    void Poll()
+    {
+        CheckAll();
+        Simulator::Schedule(m_pollInterval, &RouteWatcher::Poll, this);
+    }
+
+    void Check(Router* router)
+    {
+        router->pending = false;
+        Time now = Simulator::Now();
+        Table table;
+        for (const auto& route : CollectRoutes(router->node))
+        {
+            table.emplace(RouteKey(route.destination.Get(), route.mask.Get()), route);
+        }
+        for (const auto& entry : router->table)
+        {
+            auto found = table.find(entry.first);
+            if (found == table.end())
+            {
+                router->expiry.erase(entry.first);
+                Notify(router, RouteChange::REMOVE, entry.second, RipRoute());
+            }
+            else if (found->second.gateway != entry.second.gateway ||
+                     found->second.interface != entry.second.interface)
+            {
+                router->expiry[entry.first] = now + router->timeout;
+                Notify(router, RouteChange::NEXT_HOP, entry.second, found->second);
+            }
+            else if (found->second.metric != entry.second.metric)
+            {
+                router->expiry[entry.first] = now + router->timeout;
+                Notify(router, RouteChange::METRIC, entry.second, found->second);
+            }
+        }
+        for (const auto& entry : table)
+        {
+            if (router->table.find(entry.first) == router->table.end())
+            {
+                if (router->rip && entry.second.gateway != Ipv4Address::GetZero())
+                {
+                    router->expiry[entry.first] = now + router->timeout;
+                }
+                Notify(router, RouteChange::ADD, RipRoute(), entry.second);
+            }
+        }
+        // A route Rip kept past its predicted expiry has an unknown timeout
+        for (auto it = router->expiry.begin(); it != router->expiry.end();)
+        {
+            it = (it->second <= now) ? router->expiry.erase(it) : std::next(it);
+        }
+        router->table = std::move(table);
+        ScheduleExpiryCheck(router);
+    }
+
+    void Notify(Router* router, RouteChange::Kind kind, const RipRoute& before, const RipRoute& after)
+    {
+        RouteChange change{Simulator::Now(), router->index, kind, before, after};
+        if (m_out.is_open())
+        {
+            const RipRoute& route = (kind == RouteChange::ADD) ? after : before;
+            m_out << change.time.GetSeconds() << "," << router->name << ","
+                  << RouteChangeKindName(kind) << "," << route.destination << "/"
+                  << route.mask.GetPrefixLength() << ",";
+            if (kind != RouteChange::ADD)
+            {
+                m_out << before.gateway;
+            }
+            m_out << ",";
+            if (kind != RouteChange::REMOVE)
+            {
+                m_out << after.gateway;
+            }
+            m_out << ",";
+            if (kind != RouteChange::ADD)
+            {
+                m_out << before.metric;
+            }
+            m_out << ",";
+            if (kind != RouteChange::REMOVE)
+            {
+                m_out << after.metric;
+            }
+            m_out << "\n";
+        }
+        for (const auto& listener : m_listeners)
+        {
+            listener(change);
+        }
+    }
+
+    Time m_pollInterval;
+    std::vector<std::unique_ptr<Router>> m_routers;
+    std::map<uint32_t, Router*> m_routerOf; // By node id
+    std::vector<Listener> m_listeners;
+    std::ofstream m_out;
+};
+
+// Longest prefix match over IPv4 prefixes: a path-compressed binary trie.
+// Every node holds a prefix and branches on the bit after it, so chains of
+// single children are skipped and a lookup visits at most one node per
+// stored prefix length on the way down. Nodes are kept in a vector, linked
+// by index; Remove unlinks nodes that no longer hold a value or join two
+// branches, and their slots are reused.
+template <typename T>
+class PrefixTrie
+{
+  public:
+    PrefixTrie()
+        : m_nodes(1) // Slot 0 stands for "no node"
+    {
+    }
+
+    // Add a prefix, or replace its value.
+    void Insert(Ipv4Address prefix, Ipv4Mask mask, const T& value)
+    {
+        uint8_t length = mask.GetPrefixLength();
+        uint32_t key = prefix.Get() & MaskOf(length);
+        uint32_t parent = 0;
+        uint32_t branch = 0;
+        while (true)
+        {
+            uint32_t node = Child(parent, branch);
+            if (node == 0)
+            {
+                SetChild(parent, branch, NewNode(key, length, &value));
+                return;
+            }
+            uint32_t nodePrefix = m_nodes[node].prefix;
+            uint8_t nodeLength = m_nodes[node].length;
+            uint8_t common = CommonLength(key, nodePrefix, std::min(length, nodeLength));
+            if (common == nodeLength && common == length)
+            {
+                if (!m_nodes[node].hasValue)
+                {
+                    m_nodes[node].hasValue = true;
+                    m_size++;
+                }
+                m_nodes[node].value = value;
+                return;
+            }
+            if (common == nodeLength)
+            {
+                parent = node;
+                branch = Bit(key, nodeLength);
+                continue;
+            }
+            // The new prefix splits the edge to the node
+            uint32_t split = (common == length) ? NewNode(key, length, &value)
+                                                : NewNode(key & MaskOf(common), common, nullptr);
+            m_nodes[split].child[Bit(nodePrefix, common)] = node;
+            if (common < length)
+            {
+                m_nodes[split].child[Bit(key, common)] = NewNode(key, length, &value);
+            }
+            SetChild(parent, branch, split);
+            return;
+        }
+    }
+
+    void Remove(Ipv4Address prefix, Ipv4Mask mask)
+    {
+        uint8_t length = mask.GetPrefixLength();
+        uint32_t key = prefix.Get() & MaskOf(length);
+        uint32_t grandparent = 0;
+        uint32_t parentBranch = 0;
+        uint32_t parent = 0;
+        uint32_t branch = 0;
+        uint32_t node = Child(parent, branch);
+        while (node != 0 && m_nodes[node].length < length &&
+               ((key ^ m_nodes[node].prefix) & MaskOf(m_nodes[node].length)) == 0)
+        {
+            grandparent = parent;
+            parentBranch = branch;
+            parent = node;
+            branch = Bit(key, m_nodes[node].length);
+            node = m_nodes[node].child[branch];
+        }
+        if (node == 0 || m_nodes[node].length != length || m_nodes[node].prefix != key ||
+            !m_nodes[node].hasValue)
+        {
+            return;
+        }
+        m_nodes[node].hasValue = false;
+        m_nodes[node].value = T();
+        m_size--;
+        if (Prune(parent, branch, node) && parent != 0 && !m_nodes[parent].hasValue)
+        {
+            // The parent only joined the removed node with its other child
+            Prune(grandparent, parentBranch, parent);
+        }
+    }
+
+    // Value of exactly this prefix, nullptr if it is not stored.
+    T* Find(Ipv4Address prefix, Ipv4Mask mask)
+    {
+        return const_cast<T*>(static_cast<const PrefixTrie*>(this)->Find(prefix, mask));
+    }
+
+    const T* Find(Ipv4Address prefix, Ipv4Mask mask) const
+    {
+        uint8_t length = mask.GetPrefixLength();
+        uint32_t key = prefix.Get() & MaskOf(length);
+        uint32_t node = m_root;
+        while (node != 0 && m_nodes[node].length < length &&
+               ((key ^ m_nodes[node].prefix) & MaskOf(m_nodes[node].length)) == 0)
+        {
+            node = m_nodes[node].child[Bit(key, m_nodes[node].length)];
+        }
+        bool found = node != 0 && m_nodes[node].length == length && m_nodes[node].prefix == key &&
+                     m_nodes[node].hasValue;
+        return found ? &m_nodes[node].value : nullptr;
+    }
+
+    // Value of the longest prefix matching the address, nullptr for none.
+    const T* Lookup(Ipv4Address destination) const
+    {
+        uint32_t address = destination.Get();
+        const T* best = nullptr;
+        uint32_t node = m_root;
+        while (node != 0)
+        {
+            const Node& current = m_nodes[node];
+            if (((address ^ current.prefix) & MaskOf(current.length)) != 0)
+            {
+                break;
+            }
+            if (current.hasValue)
+            {
+                best = &current.value;
+            }
+            if (current.length == 32)
+            {
+                break;
+            }
+            node = current.child[Bit(address, current.length)];
+        }
+        return best;
+    }
+
+    // Call f(prefix, mask, value) for every stored prefix.
+    template <typename F>
+    void ForEach(F f) const
+    {
+        for (uint32_t node = 1; node < m_nodes.size(); ++node)
+        {
+            if (m_nodes[node].hasValue)
+            {
+                f(Ipv4Address(m_nodes[node].prefix),
+                  Ipv4Mask(MaskOf(m_nodes[node].length)),
+                  m_nodes[node].value);
+            }
+        }
+    }
+
+    uint32_t GetSize() const
+    {
+        return m_size;
+    }
+
+    // Nodes in use, prefixes and the branch nodes between them.
+    uint32_t GetNNodes() const
+    {
+        return m_nodes.size() - 1 - m_free.size();
+    }
+
+  private:
+    struct Node
+    {
+        uint32_t prefix{0};
+        uint8_t length{0};
+        bool hasValue{false};
+        uint32_t child[2]{0, 0};
+        T value{};
+    };
+
+    static uint32_t MaskOf(uint8_t length)
+    {
+        return length == 0 ? 0 : 0xFFFFFFFFu << (32 - length);
+    }
+
+    // Bit at a position counted from the most significant one
+    static uint32_t Bit(uint32_t address, uint8_t position)
+    {
+        return (address >> (31 - position)) & 1;
+    }
+
+    static uint8_t CommonLength(uint32_t a, uint32_t b, uint8_t limit)
+    {
+        uint32_t differ = a ^ b;
+        uint8_t common = 0;
+        while (common < limit && !(differ & (0x80000000u >> common)))
+        {
+            common++;
+        }
+        return common;
+    }
+
+    // The child of a node on a branch; the root for parent 0.
+    uint32_t Child(uint32_t parent, uint32_t branch) const
+    {
+        return parent == 0 ? m_root : m_nodes[parent].child[branch];
+    }
+
+    void SetChild(uint32_t parent, uint32_t branch, uint32_t node)
+    {
+        (parent == 0 ? m_root : m_nodes[parent].child[branch]) = node;
+    }
+
+    uint32_t NewNode(uint32_t prefix, uint8_t length, const T* value)
+    {
+        uint32_t node;
+        if (m_free.empty())
+        {
+            node = m_nodes.size();
+            m_nodes.emplace_back();
+        }
+        else
+        {
+            node = m_free.back();
+            m_free.pop_back();
+            m_nodes[node] = Node();
+        }
+        m_nodes[node].prefix = prefix;
+        m_nodes[node].length = length;
+        if (value)
+        {
+            m_nodes[node].hasValue = true;
+            m_nodes[node].value = *value;
+            m_size++;
+        }
+        return node;
+    }
+
+    // Unlink a node without value that has at most one child, replacing it
+    // by that child. Returns whether the node was freed.
+    bool Prune(uint32_t parent, uint32_t branch, uint32_t node)
+    {
+        const Node& current = m_nodes[node];
+        if (current.hasValue || (current.child[0] != 0 && current.child[1] != 0))
+        {
+            return false;
+        }
+        SetChild(parent, branch, current.child[0] != 0 ? current.child[0] : current.child[1]);
+        m_nodes[node] = Node();
+        m_free.push_back(node);
+        return true;
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_free;
+    uint32_t m_root{0};
+    uint32_t m_size{0};
+};
+
+} // namespace ns3
+
+#endif // RIP_ROUTE_WATCHER_H
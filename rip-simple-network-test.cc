@@ -0,0 +1,850 @@
+// Scenario tests of the route watcher and the detectors of rip-simple-network.cc
+//
+//    SRC
+//     |
+//     A-----B-----C
+//                 |
+//                DST
+//
+// A, B and C are RIP routers. A announces its table every second, B only
+// sends triggered updates, 20 s apart. When B sets its interface to C down
+// at 70 s, A's next update reaches B long before B's triggered update
+// reaches A, so without split horizon A and B count to infinity for the
+// networks behind C.
+//
+// Run with: ./ns3 run scratch/rip-simple-network-test.cc
+
+#include "rip-accounting.h"
+#include "rip-detectors.h"
+#include "rip-ecmp-routing.h"
+#include "rip-lpm-routing.h"
+#include "rip-spf.h"
+#include "rip-summarization.h"
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/ipv4-static-routing-helper.h"
+
+#include <map>
+#include <random>
+#include <set>
+#include <tuple>
+
+using namespace ns3;
+
+namespace
+{
+
+// The line topology above with the given split horizon strategy
+struct LineTopology
+{
+    explicit LineTopology(Rip::SplitHorizonType_e splitHorizon)
+    {
+        src = CreateObject<Node>();
+        Names::Add("SrcNode", src);
+        a = CreateObject<Node>();
+        Names::Add("RouterA", a);
+        b = CreateObject<Node>();
+        Names::Add("RouterB", b);
+        c = CreateObject<Node>();
+        Names::Add("RouterC", c);
+        dst = CreateObject<Node>();
+        Names::Add("DstNode", dst);
+        routers = NodeContainer(a, b, c);
+
+        CsmaHelper csma;
+        csma.SetChannelAttribute("DataRate", DataRateValue(5000000));
+        csma.SetChannelAttribute("Delay", TimeValue(MilliSeconds(2)));
+        NetDeviceContainer ndc1 = csma.Install(NodeContainer(src, a));
+        NetDeviceContainer ndc2 = csma.Install(NodeContainer(a, b));
+        NetDeviceContainer ndc3 = csma.Install(NodeContainer(b, c));
+        NetDeviceContainer ndc4 = csma.Install(NodeContainer(c, dst));
+
+        RipHelper ripRouting;
+        ripRouting.ExcludeInterface(a, 1);
+        ripRouting.ExcludeInterface(c, 2);
+        ripRouting.Set("SplitHorizon", EnumValue(splitHorizon));
+        Ipv4ListRoutingHelper listRH;
+        listRH.Add(ripRouting, 0);
+
+        InternetStackHelper internet;
+        internet.SetIpv6StackInstall(false);
+        internet.SetRoutingHelper(listRH);
+        internet.Install(routers);
+        InternetStackHelper internetNodes;
+        internetNodes.SetIpv6StackInstall(false);
+        internetNodes.Install(NodeContainer(src, dst));
+
+        Ipv4AddressHelper ipv4;
+        ipv4.SetBase(Ipv4Address("10.0.0.0"), Ipv4Mask("255.255.255.0"));
+        ipv4.Assign(ndc1);
+        ipv4.SetBase(Ipv4Address("10.0.1.0"), Ipv4Mask("255.255.255.0"));
+        ipv4.Assign(ndc2);
+        ipv4.SetBase(Ipv4Address("10.0.2.0"), Ipv4Mask("255.255.255.0"));
+        ipv4.Assign(ndc3);
+        ipv4.SetBase(Ipv4Address("10.0.3.0"), Ipv4Mask("255.255.255.0"));
+        ipv4.Assign(ndc4);
+
+        Ipv4RoutingHelper::GetRouting<Ipv4StaticRouting>(src->GetObject<Ipv4>()->GetRoutingProtocol())
+            ->SetDefaultRoute("10.0.0.2", 1);
+        Ipv4RoutingHelper::GetRouting<Ipv4StaticRouting>(dst->GetObject<Ipv4>()->GetRoutingProtocol())
+            ->SetDefaultRoute("10.0.3.1", 1);
+
+        GetRip(a)->SetAttribute("UnsolicitedRoutingUpdate", TimeValue(Seconds(1)));
+        GetRip(b)->SetAttribute("UnsolicitedRoutingUpdate", TimeValue(Seconds(1e6)));
+        GetRip(b)->SetAttribute("MinTriggeredCooldown", TimeValue(Seconds(20)));
+        GetRip(b)->SetAttribute("MaxTriggeredCooldown", TimeValue(Seconds(20)));
+    }
+
+    // B's interface 2 is its link to C
+    void FailB(Time at)
+    {
+        Simulator::Schedule(at, &SetInterfaceState, b, 2, false);
+    }
+
+    Ptr<Node> src;
+    Ptr<Node> a;
+    Ptr<Node> b;
+    Ptr<Node> c;
+    Ptr<Node> dst;
+    NodeContainer routers;
+};
+
+// Two equal-cost paths from A to D, through B and through C:
+//
+//    SRC
+//     |
+//     A
+//    / \   interface 2 to B (10.1.1.2), 3 to C (10.1.2.2)
+//   B   C
+//    \ /
+//     D
+//     |
+//    DST   10.1.5.2
+//
+// A forwards with RipEcmpRouting ahead of Rip.
+struct DiamondTopology
+{
+    DiamondTopology()
+    {
+        src = CreateObject<Node>();
+        a = CreateObject<Node>();
+        b = CreateObject<Node>();
+        c = CreateObject<Node>();
+        d = CreateObject<Node>();
+        dst = CreateObject<Node>();
+        NodeContainer routers(a, b, c, d);
+
+        CsmaHelper csma;
+        csma.SetChannelAttribute("DataRate", DataRateValue(5000000));
+        csma.SetChannelAttribute("Delay", TimeValue(MilliSeconds(2)));
+        std::vector<NetDeviceContainer> links = {csma.Install(NodeContainer(src, a)),
+                                                 csma.Install(NodeContainer(a, b)),
+                                                 csma.Install(NodeContainer(a, c)),
+                                                 csma.Install(NodeContainer(b, d)),
+                                                 csma.Install(NodeContainer(c, d)),
+                                                 csma.Install(NodeContainer(d, dst))};
+
+        RipHelper ripRouting;
+        ripRouting.ExcludeInterface(a, 1);
+        ripRouting.ExcludeInterface(d, 3);
+        Ipv4ListRoutingHelper listRH;
+        listRH.Add(ripRouting, 0);
+
+        InternetStackHelper internet;
+        internet.SetIpv6StackInstall(false);
+        internet.SetRoutingHelper(listRH);
+        internet.Install(routers);
+        InternetStackHelper internetNodes;
+        internetNodes.SetIpv6StackInstall(false);
+        internetNodes.Install(NodeContainer(src, dst));
+
+        Ipv4AddressHelper ipv4;
+        for (uint32_t i = 0; i < links.size(); ++i)
+        {
+            ipv4.SetBase(Ipv4Address((10u << 24) | (1u << 16) | (i << 8)), Ipv4Mask("255.255.255.0"));
+            ipv4.Assign(links[i]);
+        }
+
+        Ipv4RoutingHelper::GetRouting<Ipv4StaticRouting>(src->GetObject<Ipv4>()->GetRoutingProtocol())
+            ->SetDefaultRoute("10.1.0.2", 1);
+        Ipv4RoutingHelper::GetRouting<Ipv4StaticRouting>(dst->GetObject<Ipv4>()->GetRoutingProtocol())
+            ->SetDefaultRoute("10.1.5.1", 1);
+
+        ecmp = CreateObject<RipEcmpRouting>();
+        DynamicCast<Ipv4ListRouting>(a->GetObject<Ipv4>()->GetRoutingProtocol())
+            ->AddRoutingProtocol(ecmp, 10);
+    }
+
+    Ptr<Node> src;
+    Ptr<Node> a;
+    Ptr<Node> b;
+    Ptr<Node> c;
+    Ptr<Node> d;
+    Ptr<Node> dst;
+    Ptr<RipEcmpRouting> ecmp;
+};
+
+// Base of the scenario tests: every test builds its own nodes
+class RipScenarioTestCase : public TestCase
+{
+  public:
+    using TestCase::TestCase;
+
+  private:
+    void DoTeardown() override
+    {
+        Simulator::Destroy();
+        g_interfaceListeners.clear();
+        Names::Clear();
+    }
+};
+
+// The watched tables equal the Rip tables at times no update is sent.
+class RouteWatcherTestCase : public RipScenarioTestCase
+{
+  public:
+    RouteWatcherTestCase()
+        : RipScenarioTestCase("Route watcher follows the Rip tables")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        LineTopology topology(Rip::NO_SPLIT_HORIZON);
+        RouteWatcher watcher(topology.routers, Seconds(0));
+        uint32_t changesAfterFailure = 0;
+        watcher.AddListener([&changesAfterFailure](const RouteChange& change) {
+            changesAfterFailure += change.time >= Seconds(70) ? 1 : 0;
+        });
+        topology.FailB(Seconds(70));
+        for (double at : {37.123, 71.377, 97.31, 133.71, 239.9})
+        {
+            Simulator::Schedule(Seconds(at), &RouteWatcherTestCase::Compare, this, &watcher);
+        }
+        Simulator::Stop(Seconds(250));
+        Simulator::Run();
+
+        NS_TEST_ASSERT_MSG_GT(changesAfterFailure, 0u, "No route changes seen after the failure");
+    }
+
+    void Compare(const RouteWatcher* watcher)
+    {
+        for (uint32_t router = 0; router < watcher->GetNRouters(); ++router)
+        {
+            const RouteWatcher::Table& watched = watcher->GetTable(router);
+            std::vector<RipRoute> routes = CollectRipRoutes(GetRip(watcher->GetNode(router)));
+            NS_TEST_EXPECT_MSG_EQ(watched.size(),
+                                  routes.size(),
+                                  watcher->GetName(router) << " at " << Simulator::Now().As(Time::S));
+            for (const auto& route : routes)
+            {
+                auto entry = watched.find({route.destination.Get(), route.mask.Get()});
+                NS_TEST_EXPECT_MSG_EQ((entry != watched.end()),
+                                      true,
+                                      watcher->GetName(router) << " misses " << route.destination);
+                if (entry != watched.end())
+                {
+                    NS_TEST_EXPECT_MSG_EQ(entry->second.gateway, route.gateway, route.destination);
+                    NS_TEST_EXPECT_MSG_EQ(entry->second.metric, route.metric, route.destination);
+                }
+            }
+        }
+    }
+};
+
+// Count to infinity without split horizon, none with it.
+class CountToInfinityTestCase : public RipScenarioTestCase
+{
+  public:
+    CountToInfinityTestCase(Rip::SplitHorizonType_e splitHorizon, bool expectEpisodes)
+        : RipScenarioTestCase(expectEpisodes ? "Count to infinity without split horizon"
+                                             : "No count to infinity with split horizon"),
+          m_splitHorizon(splitHorizon),
+          m_expectEpisodes(expectEpisodes)
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        LineTopology topology(m_splitHorizon);
+        RouteWatcher watcher(topology.routers, Seconds(0));
+        // B raises its metric every 20 s
+        CountToInfinityDetector detector(&watcher, Seconds(30), 3);
+        topology.FailB(Seconds(70));
+        Simulator::Stop(Seconds(250));
+        Simulator::Run();
+
+        std::ostringstream report;
+        detector.Report(report);
+        if (m_expectEpisodes)
+        {
+            NS_TEST_ASSERT_MSG_GT(detector.GetNEpisodes(), 0, report.str());
+        }
+        else
+        {
+            NS_TEST_ASSERT_MSG_EQ(detector.GetNEpisodes(), 0, report.str());
+        }
+    }
+
+    Rip::SplitHorizonType_e m_splitHorizon;
+    bool m_expectEpisodes;
+};
+
+// A's updates are periodic, B's are triggered.
+class RipOverheadTestCase : public RipScenarioTestCase
+{
+  public:
+    RipOverheadTestCase()
+        : RipScenarioTestCase("RIP overhead tells periodic and triggered updates apart")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        LineTopology topology(Rip::SPLIT_HORIZON);
+        std::map<uint32_t, std::string> strategies;
+        for (auto it = topology.routers.Begin(); it != topology.routers.End(); ++it)
+        {
+            strategies[(*it)->GetId()] = "SplitHorizon";
+        }
+        RipOverhead overhead(topology.routers, Seconds(10), strategies);
+        topology.FailB(Seconds(70));
+        Simulator::Stop(Seconds(120));
+        Simulator::Run();
+
+        NS_TEST_ASSERT_MSG_GT(overhead.GetTotal(RipOverhead::PERIODIC_TX), 0, "No periodic updates");
+        NS_TEST_ASSERT_MSG_GT(overhead.GetTotal(RipOverhead::TRIGGERED_TX), 0, "No triggered updates");
+        NS_TEST_ASSERT_MSG_GT(overhead.GetTotal(RipOverhead::RTES_RX), 0, "No RTEs received");
+    }
+};
+
+// A silently failed link is told apart from a full queue.
+class DropAccountingTestCase : public RipScenarioTestCase
+{
+  public:
+    DropAccountingTestCase()
+        : RipScenarioTestCase("Drop accounting charges a silent link failure to the link")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        LineTopology topology(Rip::SPLIT_HORIZON);
+        DropAccounting drops(Seconds(1));
+
+        UdpServerHelper server(9000);
+        ApplicationContainer serverApps = server.Install(topology.dst);
+        serverApps.Start(Seconds(1.0));
+        serverApps.Stop(Seconds(90.0));
+        UdpClientHelper client(Ipv4Address("10.0.3.2"), 9000);
+        client.SetAttribute("MaxPackets", UintegerValue(0));
+        client.SetAttribute("Interval", TimeValue(MilliSeconds(100)));
+        client.SetAttribute("PacketSize", UintegerValue(512));
+        ApplicationContainer clientApps = client.Install(topology.src);
+        clientApps.Start(Seconds(50.0));
+        clientApps.Stop(Seconds(90.0));
+
+        // B and C resolve each other's addresses before the link goes silent
+        Simulator::Schedule(Seconds(60), &SetLinkSilent, topology.b, 2, true);
+        Simulator::Schedule(Seconds(60), &SetLinkSilent, topology.c, 1, true);
+        Simulator::Stop(Seconds(90));
+        Simulator::Run();
+
+        NS_TEST_ASSERT_MSG_GT(drops.GetTotal(DropAccounting::LINK_DOWN), 0, "No link drops");
+        NS_TEST_ASSERT_MSG_EQ(drops.GetTotal(DropAccounting::QUEUE_FULL), 0, "Queue drops");
+    }
+};
+
+// A spreads flows over both next hops, and keeps forwarding over the other
+// one at once when an interface goes down.
+class EcmpTestCase : public RipScenarioTestCase
+{
+  public:
+    EcmpTestCase()
+        : RipScenarioTestCase("ECMP spreads flows over equal-cost next hops and fails over")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        DiamondTopology topology;
+        for (uint16_t port = 9000; port < 9016; ++port)
+        {
+            UdpServerHelper server(port);
+            ApplicationContainer serverApps = server.Install(topology.dst);
+            serverApps.Start(Seconds(1.0));
+            serverApps.Stop(Seconds(60.0));
+            UdpClientHelper client(Ipv4Address("10.1.5.2"), port);
+            client.SetAttribute("MaxPackets", UintegerValue(0));
+            client.SetAttribute("Interval", TimeValue(MilliSeconds(100)));
+            client.SetAttribute("PacketSize", UintegerValue(512));
+            ApplicationContainer clientApps = client.Install(topology.src);
+            clientApps.Start(Seconds(20.0));
+            clientApps.Stop(Seconds(60.0));
+        }
+        Simulator::Schedule(Seconds(39.5), &EcmpTestCase::CheckBoth, this, topology.ecmp);
+        Simulator::Schedule(Seconds(40), &SetInterfaceState, topology.a, 2, false);
+        Simulator::Schedule(Seconds(40.5), &EcmpTestCase::CheckFailover, this, topology.ecmp);
+        Simulator::Stop(Seconds(60));
+        Simulator::Run();
+
+        NS_TEST_ASSERT_MSG_EQ(topology.ecmp->GetPackets(m_viaB), m_viaBAtFailure, "Packets sent via B");
+        NS_TEST_ASSERT_MSG_GT(topology.ecmp->GetPackets(m_viaC),
+                              m_viaCAtFailure + 100,
+                              "C did not take over the flows of B");
+    }
+
+    void CheckBoth(Ptr<RipEcmpRouting> ecmp)
+    {
+        std::vector<Ipv4Address> hops = ecmp->GetNextHops(Ipv4Address("10.1.5.2"));
+        NS_TEST_EXPECT_MSG_EQ(hops.size(), 2, "Equal-cost next hops of DST");
+        NS_TEST_EXPECT_MSG_GT(ecmp->GetPackets(m_viaB), 0, "No flow forwarded via B");
+        NS_TEST_EXPECT_MSG_GT(ecmp->GetPackets(m_viaC), 0, "No flow forwarded via C");
+        m_viaBAtFailure = ecmp->GetPackets(m_viaB);
+    }
+
+    void CheckFailover(Ptr<RipEcmpRouting> ecmp)
+    {
+        std::vector<Ipv4Address> hops = ecmp->GetNextHops(Ipv4Address("10.1.5.2"));
+        NS_TEST_EXPECT_MSG_EQ(hops.size(), 1, "Next hops of DST after the failure");
+        NS_TEST_EXPECT_MSG_EQ((!hops.empty() && hops[0] == m_viaC), true, "C is the next hop");
+        m_viaCAtFailure = ecmp->GetPackets(m_viaC);
+    }
+
+    const Ipv4Address m_viaB{"10.1.1.2"};
+    const Ipv4Address m_viaC{"10.1.2.2"};
+    uint64_t m_viaBAtFailure{0};
+    uint64_t m_viaCAtFailure{0};
+};
+
+// Insert, remove and longest match of the prefix trie, from the default
+// route to host routes, then random changes against a linear scan.
+class PrefixTrieTestCase : public TestCase
+{
+  public:
+    PrefixTrieTestCase()
+        : TestCase("Prefix trie matches the longest prefix")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        PrefixTrie<int> trie;
+        trie.Insert(Ipv4Address("0.0.0.0"), Ipv4Mask("0.0.0.0"), 0);
+        trie.Insert(Ipv4Address("10.0.0.0"), Ipv4Mask("255.0.0.0"), 8);
+        trie.Insert(Ipv4Address("10.1.0.0"), Ipv4Mask("255.255.0.0"), 16);
+        trie.Insert(Ipv4Address("10.1.2.3"), Ipv4Mask("255.255.255.255"), 32);
+        NS_TEST_EXPECT_MSG_EQ(Match(trie, "10.1.2.3"), 32, "Host route");
+        NS_TEST_EXPECT_MSG_EQ(Match(trie, "10.1.2.4"), 16, "Next to the host route");
+        NS_TEST_EXPECT_MSG_EQ(Match(trie, "10.2.0.1"), 8, "Outside the /16");
+        NS_TEST_EXPECT_MSG_EQ(Match(trie, "192.168.0.1"), 0, "Default route");
+        trie.Insert(Ipv4Address("10.1.9.9"), Ipv4Mask("255.255.0.0"), 17);
+        NS_TEST_EXPECT_MSG_EQ(trie.GetSize(), 4, "Replacing a value adds no prefix");
+        NS_TEST_EXPECT_MSG_EQ(Match(trie, "10.1.2.4"), 17, "Replaced value");
+
+        trie.Remove(Ipv4Address("10.1.0.0"), Ipv4Mask("255.255.0.0"));
+        NS_TEST_EXPECT_MSG_EQ(Match(trie, "10.1.2.4"), 8, "After removing the /16");
+        NS_TEST_EXPECT_MSG_EQ(Match(trie, "10.1.2.3"), 32, "The host route stays");
+        trie.Remove(Ipv4Address("0.0.0.0"), Ipv4Mask("0.0.0.0"));
+        NS_TEST_EXPECT_MSG_EQ(Match(trie, "192.168.0.1"), -1, "After removing the default route");
+        trie.Remove(Ipv4Address("10.1.2.3"), Ipv4Mask("255.255.255.255"));
+        NS_TEST_EXPECT_MSG_EQ(Match(trie, "10.1.2.3"), 8, "After removing the host route");
+        trie.Remove(Ipv4Address("10.0.0.0"), Ipv4Mask("255.0.0.0"));
+        NS_TEST_EXPECT_MSG_EQ(trie.GetSize(), 0, "Prefixes left");
+        NS_TEST_EXPECT_MSG_EQ(trie.GetNNodes(), 0, "Nodes left");
+
+        // Random prefixes, many of them nested in 10.0.0.0/14
+        std::mt19937 random(1);
+        std::map<std::pair<uint32_t, uint32_t>, int> prefixes;
+        auto maskOf = [](uint32_t length) {
+            return length == 0 ? 0 : 0xFFFFFFFFu << (32 - length);
+        };
+        auto address = [&random]() {
+            return (random() % 2) ? static_cast<uint32_t>(random())
+                                  : (0x0A000000u | (random() & 0x3FFFF) << 8 | (random() & 0xFF));
+        };
+        for (int change = 0; change < 20000; ++change)
+        {
+            uint32_t mask = maskOf(random() % 33);
+            uint32_t prefix = address() & mask;
+            if (random() % 3 != 0 || prefixes.empty())
+            {
+                trie.Insert(Ipv4Address(prefix), Ipv4Mask(mask), change);
+                prefixes[{prefix, mask}] = change;
+            }
+            else
+            {
+                auto victim = std::next(prefixes.begin(), random() % prefixes.size());
+                trie.Remove(Ipv4Address(victim->first.first), Ipv4Mask(victim->first.second));
+                prefixes.erase(victim);
+            }
+            uint32_t destination = address();
+            int expected = -1;
+            uint32_t longest = 0;
+            for (const auto& entry : prefixes)
+            {
+                if ((destination & entry.first.second) == entry.first.first &&
+                    (expected < 0 || entry.first.second >= longest))
+                {
+                    expected = entry.second;
+                    longest = entry.first.second;
+                }
+            }
+            const int* found = trie.Lookup(Ipv4Address(destination));
+            NS_TEST_ASSERT_MSG_EQ((found ? *found : -1), expected, Ipv4Address(destination));
+        }
+        NS_TEST_ASSERT_MSG_EQ(trie.GetSize(), prefixes.size(), "Prefixes after the changes");
+        NS_TEST_EXPECT_MSG_GT(2 * prefixes.size() + 1, trie.GetNNodes(), "More nodes than needed");
+        for (const auto& entry : prefixes)
+        {
+            trie.Remove(Ipv4Address(entry.first.first), Ipv4Mask(entry.first.second));
+        }
+        NS_TEST_EXPECT_MSG_EQ(trie.GetNNodes(), 0, "Nodes left after removing every prefix");
+    }
+
+    static int Match(const PrefixTrie<int>& trie, const char* destination)
+    {
+        const int* found = trie.Lookup(Ipv4Address(destination));
+        return found ? *found : -1;
+    }
+};
+
+// The tries that RipLpmRouting learns from the RIP responses equal the Rip
+// tables, through count to infinity, and forward the transit packets.
+class LpmRoutingTestCase : public RipScenarioTestCase
+{
+  public:
+    LpmRoutingTestCase()
+        : RipScenarioTestCase("LPM routing learns the Rip tables from the responses")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        LineTopology topology(Rip::NO_SPLIT_HORIZON);
+        std::vector<Ptr<RipLpmRouting>> lpm;
+        for (auto it = topology.routers.Begin(); it != topology.routers.End(); ++it)
+        {
+            lpm.push_back(CreateObject<RipLpmRouting>());
+            DynamicCast<Ipv4ListRouting>((*it)->GetObject<Ipv4>()->GetRoutingProtocol())
+                ->AddRoutingProtocol(lpm.back(), 5);
+        }
+        UdpServerHelper server(9000);
+        ApplicationContainer serverApps = server.Install(topology.dst);
+        serverApps.Start(Seconds(1.0));
+        UdpClientHelper client(Ipv4Address("10.0.3.2"), 9000);
+        client.SetAttribute("MaxPackets", UintegerValue(0));
+        client.SetAttribute("Interval", TimeValue(Seconds(1)));
+        ApplicationContainer clientApps = client.Install(topology.src);
+        clientApps.Start(Seconds(20.0));
+        clientApps.Stop(Seconds(60.0));
+        topology.FailB(Seconds(70));
+        for (double at : {37.123, 71.377, 97.31, 133.71, 239.9})
+        {
+            Simulator::Schedule(Seconds(at),
+                                &LpmRoutingTestCase::Compare,
+                                this,
+                                topology.routers,
+                                lpm);
+        }
+        Simulator::Stop(Seconds(250));
+        Simulator::Run();
+
+        NS_TEST_ASSERT_MSG_GT(lpm[0]->GetNForwarded(), 30, "Packets A forwarded by its trie");
+    }
+
+    void Compare(NodeContainer routers, const std::vector<Ptr<RipLpmRouting>>& lpm)
+    {
+        for (uint32_t i = 0; i < routers.GetN(); ++i)
+        {
+            std::vector<RipRoute> routes = CollectRipRoutes(GetRip(routers.Get(i)));
+            std::ostringstream at;
+            at << Names::FindName(routers.Get(i)) << " at " << Simulator::Now().As(Time::S);
+            NS_TEST_EXPECT_MSG_EQ(lpm[i]->GetNRoutes(), routes.size(), at.str());
+            for (const auto& route : routes)
+            {
+                const RipLpmRouting::Route* learned =
+                    lpm[i]->GetRoute(route.destination, route.mask);
+                NS_TEST_EXPECT_MSG_EQ((learned != nullptr),
+                                      true,
+                                      at.str() << " misses " << route.destination);
+                if (learned)
+                {
+                    NS_TEST_EXPECT_MSG_EQ(learned->gateway, route.gateway, route.destination);
+                    NS_TEST_EXPECT_MSG_EQ(learned->metric, route.metric, route.destination);
+                    NS_TEST_EXPECT_MSG_EQ(learned->interface, route.interface, route.destination);
+                }
+            }
+        }
+    }
+};
+
+// B announces the networks towards C, 10.0.2.0/24 and 10.0.3.0/24, to A as
+// 10.0.2.0/23. When C's link to DST fails B withdraws the aggregate and A
+// keeps a route to the component left; once B's link to C fails as well A
+// has no route into the aggregate.
+class SummarizationTestCase : public RipScenarioTestCase
+{
+  public:
+    SummarizationTestCase()
+        : RipScenarioTestCase("Summarization withdraws the aggregate of failed components")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        LineTopology topology(Rip::SPLIT_HORIZON);
+        Ptr<NetDevice> device = topology.b->GetObject<Ipv4>()->GetNetDevice(1);
+        TrafficControlHelper defaultQueueDisc;
+        defaultQueueDisc.Uninstall(device);
+        TrafficControlHelper pacing;
+        pacing.SetRootQueueDisc("RipSimpleRouting::RipPacingQueueDisc",
+                                "Gap",
+                                TimeValue(Seconds(0)),
+                                "Jitter",
+                                TimeValue(Seconds(0)));
+        pacing.Install(device);
+        RouteSummarization summarization(
+            {{topology.b, 1, Ipv4Address("10.0.2.0"), Ipv4Mask("255.255.254.0")}});
+
+        Simulator::Schedule(Seconds(60), &SetInterfaceState, topology.c, 2, false);
+        topology.FailB(Seconds(120));
+        // Metrics at A of the aggregate, 10.0.2.0/24 and 10.0.3.0/24
+        auto check = &SummarizationTestCase::Check;
+        Simulator::Schedule(Seconds(50), check, this, topology.a, 2, 16, 16);
+        Simulator::Schedule(Seconds(100), check, this, topology.a, 16, 2, 16);
+        Simulator::Schedule(Seconds(160), check, this, topology.a, 16, 16, 16);
+        Simulator::Stop(Seconds(170));
+        Simulator::Run();
+    }
+
+    // Metrics of A's routes via B, 16 for no route
+    void Check(Ptr<Node> a, uint32_t aggregate, uint32_t near, uint32_t far)
+    {
+        Time at = Simulator::Now();
+        NS_TEST_EXPECT_MSG_EQ(Metric(a, "10.0.2.0", "255.255.254.0"),
+                              aggregate,
+                              "Aggregate at " << at.As(Time::S));
+        NS_TEST_EXPECT_MSG_EQ(Metric(a, "10.0.2.0", "255.255.255.0"),
+                              near,
+                              "10.0.2.0/24 at " << at.As(Time::S));
+        NS_TEST_EXPECT_MSG_EQ(Metric(a, "10.0.3.0", "255.255.255.0"),
+                              far,
+                              "10.0.3.0/24 at " << at.As(Time::S));
+    }
+
+    static uint32_t Metric(Ptr<Node> node, const char* destination, const char* mask)
+    {
+        for (const auto& route : CollectRipRoutes(GetRip(node)))
+        {
+            if (route.destination == Ipv4Address(destination) && route.mask == Ipv4Mask(mask) &&
+                route.gateway == Ipv4Address("10.0.1.2"))
+            {
+                return route.metric;
+            }
+        }
+        return 16;
+    }
+};
+
+// Networks added on C's interface to DST, which Rip excludes, reach A in a
+// multi-packet update.
+class AnnouncedAddressesTestCase : public RipScenarioTestCase
+{
+  public:
+    AnnouncedAddressesTestCase()
+        : RipScenarioTestCase("Rip announces the networks added on an excluded interface")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        LineTopology topology(Rip::SPLIT_HORIZON);
+        std::vector<Ipv4InterfaceAddress> addresses;
+        for (uint32_t i = 0; i < m_prefixes; ++i)
+        {
+            addresses.emplace_back(Ipv4Address((20u << 24) | (i << 8) | 1),
+                                   Ipv4Mask("255.255.255.0"));
+        }
+        uint32_t before = CollectRipRoutes(GetRip(topology.c)).size();
+        AddAnnouncedAddresses(topology.c, 2, addresses);
+        NS_TEST_ASSERT_MSG_EQ(CollectRipRoutes(GetRip(topology.c)).size(),
+                              before + m_prefixes,
+                              "Routes of C");
+        NS_TEST_ASSERT_MSG_EQ(GetRip(topology.c)->GetInterfaceExclusions().count(2),
+                              1,
+                              "C's interface to DST is excluded again");
+        Simulator::Stop(Seconds(50));
+        Simulator::Run();
+
+        uint32_t learned = 0;
+        for (const auto& route : CollectRipRoutes(GetRip(topology.a)))
+        {
+            if (route.destination.CombineMask(Ipv4Mask("255.0.0.0")) == Ipv4Address("20.0.0.0") &&
+                route.gateway == Ipv4Address("10.0.1.2") && route.metric == 3)
+            {
+                learned++;
+            }
+        }
+        NS_TEST_ASSERT_MSG_EQ(learned, m_prefixes, "Extra networks A learned via B");
+    }
+
+    const uint32_t m_prefixes{200}; // Three RIP messages on a 1500 byte MTU
+};
+
+// SPF trees repaired in place through random link failures and recoveries,
+// several links at a time, against trees built from scratch on the links
+// that are up. Equal-cost paths may differ, so the first hops are checked
+// to lie on a shortest path.
+class SpfRepairTestCase : public TestCase
+{
+  public:
+    SpfRepairTestCase()
+        : TestCase("SPF repairs equal full computations under random link failures")
+    {
+    }
+
+  private:
+    using Link = std::tuple<uint32_t, uint32_t, uint32_t>; // From, to, cost
+
+    void DoRun() override
+    {
+        std::mt19937 random(1);
+        const uint32_t side = 6;
+        std::vector<Link> links;
+        std::vector<std::pair<uint32_t, uint32_t>> edges; // Both directions of a grid edge
+        for (uint32_t router = 0; router < side * side; ++router)
+        {
+            for (uint32_t neighbor : {router + 1, router + side})
+            {
+                if ((neighbor == router + 1 && neighbor % side == 0) || neighbor >= side * side)
+                {
+                    continue;
+                }
+                edges.emplace_back(links.size(), links.size() + 1);
+                links.emplace_back(router, neighbor, 1 + random() % 10);
+                links.emplace_back(neighbor, router, 1 + random() % 10);
+            }
+        }
+        SpfGraph graph;
+        Build(graph, side * side, links);
+        graph.ComputeAll();
+
+        std::set<std::size_t> failed; // Edges down
+        for (uint32_t step = 0; step < 300; ++step)
+        {
+            bool up = !failed.empty() && random() % 2 == 0;
+            std::vector<uint32_t> changed;
+            for (uint32_t count = 1 + random() % 3; count > 0; --count)
+            {
+                std::size_t edge = random() % edges.size();
+                if (up)
+                {
+                    if (failed.empty())
+                    {
+                        break;
+                    }
+                    auto it = std::next(failed.begin(), random() % failed.size());
+                    edge = *it;
+                    failed.erase(it);
+                }
+                else if (!failed.insert(edge).second)
+                {
+                    continue;
+                }
+                changed.push_back(edges[edge].first);
+                changed.push_back(edges[edge].second);
+            }
+            graph.SetLinks(changed, up);
+
+            SpfGraph fresh;
+            Build(fresh, side * side, links);
+            std::vector<uint32_t> down;
+            for (std::size_t edge : failed)
+            {
+                down.push_back(edges[edge].first);
+                down.push_back(edges[edge].second);
+            }
+            fresh.SetLinks(down, false);
+            fresh.ComputeAll();
+            for (uint32_t source = 0; source < side * side; ++source)
+            {
+                for (uint32_t router = 0; router < side * side; ++router)
+                {
+                    uint32_t distance = fresh.GetDistance(source, router);
+                    NS_TEST_ASSERT_MSG_EQ(graph.GetDistance(source, router),
+                                          distance,
+                                          "Step " << step << " from " << source << " to " << router);
+                    int32_t hop = graph.GetFirstHop(source, router);
+                    if (source == router || distance == SpfGraph::UNREACHABLE)
+                    {
+                        NS_TEST_ASSERT_MSG_EQ(hop, -1, "First hop to " << router);
+                        continue;
+                    }
+                    NS_TEST_ASSERT_MSG_EQ((hop >= 0 && graph.IsLinkUp(hop) &&
+                                           graph.GetLinkFrom(hop) == source),
+                                          true,
+                                          "Step " << step << " first hop from " << source);
+                    NS_TEST_ASSERT_MSG_EQ(std::get<2>(links[hop]) +
+                                              fresh.GetDistance(graph.GetLinkTo(hop), router),
+                                          distance,
+                                          "Step " << step << " first hop from " << source
+                                                  << " to " << router << " is no shortest path");
+                }
+            }
+        }
+    }
+
+    static void Build(SpfGraph& graph, uint32_t routers, const std::vector<Link>& links)
+    {
+        for (uint32_t router = 0; router < routers; ++router)
+        {
+            graph.AddRouter();
+        }
+        for (const auto& link : links)
+        {
+            graph.AddLink(std::get<0>(link), std::get<1>(link), std::get<2>(link));
+        }
+    }
+};
+
+class RipSimpleNetworkTestSuite : public TestSuite
+{
+  public:
+    RipSimpleNetworkTestSuite()
+        : TestSuite("rip-simple-network", Type::SYSTEM)
+    {
+        AddTestCase(new RouteWatcherTestCase(), Duration::QUICK);
+        AddTestCase(new CountToInfinityTestCase(Rip::NO_SPLIT_HORIZON, true), Duration::QUICK);
+        AddTestCase(new CountToInfinityTestCase(Rip::SPLIT_HORIZON, false), Duration::QUICK);
+        AddTestCase(new RipOverheadTestCase(), Duration::QUICK);
+        AddTestCase(new DropAccountingTestCase(), Duration::QUICK);
+        AddTestCase(new EcmpTestCase(), Duration::QUICK);
+        AddTestCase(new SummarizationTestCase(), Duration::QUICK);
+        AddTestCase(new AnnouncedAddressesTestCase(), Duration::QUICK);
+        AddTestCase(new SpfRepairTestCase(), Duration::QUICK);
+        AddTestCase(new PrefixTrieTestCase(), Duration::QUICK);
+        AddTestCase(new LpmRoutingTestCase(), Duration::QUICK);
+    }
+};
+
+RipSimpleNetworkTestSuite g_ripSimpleNetworkTestSuite;
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    return TestRunner::Run(argc, argv);
+}
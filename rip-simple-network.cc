@@ -15,15 +15,15 @@
 //       DST
 // Two paths SRC-> A -> B -> D (1+1+1=3)
 // Another path SRC-> A->C->D->DST (1+1+10=12)
-// A, B, C and D are RIPng routers.
+// A, B, C and D are RIP routers.
 // A and D are configured with static addresses.
 // SRC and DST will exchange packets.
 //
 // After about 3 seconds, the topology is built, and Echo Reply will be received.
 // After 40 seconds, the link between B and D will break, causing a route failure.
 // After 44 seconds from the failure, the routers will recovery from the failure.
-// Split Horizoning should affect the recovery time, but it is not. See the manual
-// for an explanation of this effect.
+// The split horizon strategy is applied to every RIP router, and can be
+// overridden per router with "splitHorizonOverrides".
 //
 // If "showPings" is enabled, the user will see:
 // 1) if the ping has been acknowledged
@@ -32,50 +32,2544 @@
 //    the Echo Reply is unable to reach the sender.
 // Examining the .pcap files with Wireshark can confirm this effect.
 
+#include "rip-accounting.h"
+#include "rip-detectors.h"
+#include "rip-ecmp-routing.h"
+#include "rip-lpm-routing.h"
+#include "rip-spf.h"
+#include "rip-summarization.h"
+
 #include "ns3/core-module.h"
 #include "ns3/csma-module.h"
 #include "ns3/internet-apps-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/animation-interface.h"
+#include "ns3/applications-module.h"
 #include "ns3/ipv4-routing-table-entry.h"
 #include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/traffic-control-module.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <deque>
+#include <fcntl.h>
 #include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <set>
+#include <sstream>
+#include <streambuf>
+#include <sys/uio.h>
+#include <tuple>
+#include <typeindex>
+#include <unistd.h>
+#include <unordered_map>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("RipSimpleRouting");
+
+// Global pointer to animation interface
+AnimationInterface* g_anim = nullptr;
+
+// Silent failures break the channel without telling the IPv4 interfaces
+bool g_silentFailures = false;
+
+// Triggered-only RIP: no periodic updates, full tables only on adjacency start
+bool g_triggeredRip = false;
+
+// Ask the RIP neighbors on an interface for their whole table, like Rip does
+// at startup.
+void RequestFullTable(Ptr<Node> node, uint32_t interface)
+{
+    RipRte wholeTable;
+    wholeTable.SetPrefix(Ipv4Address::GetAny());
+    wholeTable.SetSubnetMask(Ipv4Mask::GetZero());
+    wholeTable.SetRouteMetric(16);
+    RipHeader request;
+    request.SetCommand(RipHeader::REQUEST);
+    request.AddRte(wholeTable);
+    for (const auto& neighbor : GetLinkNeighbors(node, interface))
+    {
+        SendRipTo(node, interface, neighbor.second, request);
+    }
+}
+
+void TearDownLink(Ptr<Node> nodeA, Ptr<Node> nodeB, uint32_t interfaceA, uint32_t interfaceB)
+{
+    if (g_silentFailures)
+    {
+        SetLinkSilent(nodeA, interfaceA, true);
+        SetLinkSilent(nodeB, interfaceB, true);
+    }
+    else
+    {
+        SetInterfaceState(nodeA, interfaceA, false);
+        SetInterfaceState(nodeB, interfaceB, false);
+    }
+    
+    // Visualize link failure in animation
+    if (g_anim) {
+        std::string description = "Link Down";
+        g_anim->UpdateNodeColor(nodeA, 255, 0, 0); // Red for failed node
+        g_anim->UpdateNodeColor(nodeB, 255, 0, 0);
+        g_anim->UpdateNodeDescription(nodeA, description);
+        g_anim->UpdateNodeDescription(nodeB, description);
+    }
+}
+
+void RecoverLink(Ptr<Node> nodeA, Ptr<Node> nodeB, uint32_t interfaceA, uint32_t interfaceB)
+{
+    if (g_silentFailures)
+    {
+        SetLinkSilent(nodeA, interfaceA, false);
+        SetLinkSilent(nodeB, interfaceB, false);
+    }
+    else
+    {
+        SetInterfaceState(nodeA, interfaceA, true);
+        SetInterfaceState(nodeB, interfaceB, true);
+        if (g_triggeredRip)
+        {
+            RequestFullTable(nodeA, interfaceA);
+            RequestFullTable(nodeB, interfaceB);
+        }
+    }
+    
+    // Visualize link recovery in animation
+    if (g_anim) {
+        std::string description = "Link Up";
+        g_anim->UpdateNodeColor(nodeA, 0, 255, 0); // Green for recovered node
+        g_anim->UpdateNodeColor(nodeB, 0, 255, 0);
+        g_anim->UpdateNodeDescription(nodeA, description);
+        g_anim->UpdateNodeDescription(nodeB, description);
+    }
+}
+
+// A scheduled link failure or recovery. main schedules TearDownLink or
+// RecoverLink from the same list it hands to the per-event reports.
+struct TopologyEvent
+{
+    Time at;
+    bool up;
+    Ptr<Node> nodeA;
+    Ptr<Node> nodeB;
+    uint32_t interfaceA;
+    uint32_t interfaceB;
+    std::string description;
+};
+
+// Scheduler that instruments the event loop. With profiling enabled, the
+// wall time between two RemoveNext() calls, i.e. the execution of the event
+// returned by the first call, is attributed to the event's implementation
+// type (which names the callback target) and to the event's node context.
+class InstrumentedScheduler : public MapScheduler
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("RipSimpleRouting::InstrumentedScheduler")
+                                .SetParent<MapScheduler>()
+                                .SetGroupName("Core")
+                                .AddConstructor<InstrumentedScheduler>();
+        return tid;
+    }
+
+    InstrumentedScheduler()
+    {
+        s_instance = this;
+    }
+
+    ~InstrumentedScheduler() override
+    {
+        if (s_instance == this)
+        {
+            s_instance = nullptr;
+        }
+    }
+
+    // The scheduler of the running simulation, if it is instrumented.
+    static InstrumentedScheduler* Get()
+    {
+        return s_instance;
+    }
+
+    void EnableProfiling()
+    {
+        m_profiling = true;
+    }
+
+    // Print progress every given wall-clock interval, with an estimate of the
+    // wall time left until the stop time. The clock is read every 4096 events.
+    void EnableProgress(double wallInterval, Time stop)
+    {
+        m_progressInterval = wallInterval;
+        m_progressStop = stop;
+        m_progressStart = std::chrono::steady_clock::now();
+        m_progressLast = m_progressStart;
+    }
+
+    void Insert(const Event& event) override
+    {
+        MapScheduler::Insert(event);
+        m_pending++;
+    }
+
+    void Remove(const Event& event) override
+    {
+        MapScheduler::Remove(event);
+        m_pending--;
+    }
+
+    Event RemoveNext() override
+    {
+        Event event = MapScheduler::RemoveNext();
+        m_events++;
+        m_pending--;
+        if (m_progressInterval > 0 && (m_events & 4095) == 0)
+        {
+            Progress(TimeStep(event.key.m_ts));
+        }
+        if (m_profiling)
+        {
+            auto now = std::chrono::steady_clock::now();
+            Close(now);
+            m_currentType = std::type_index(typeid(*event.impl));
+            m_currentContext = event.key.m_context;
+            m_currentStart = now;
+            m_running = true;
+        }
+        return event;
+    }
+
+    uint64_t GetEventCount() const
+    {
+        return m_events;
+    }
+
+    uint64_t GetPendingEvents() const
+    {
+        return m_pending;
+    }
+
+    void Report(std::ostream& os, uint32_t top)
+    {
+        Close(std::chrono::steady_clock::now());
+        m_running = false;
+        double total = 0;
+        for (const auto& entry : m_byType)
+        {
+            total += entry.second.seconds;
+        }
+        std::vector<std::pair<std::string, Usage>> types;
+        for (const auto& entry : m_byType)
+        {
+            types.emplace_back(Demangle(entry.first.name()), entry.second);
+        }
+        std::vector<std::pair<std::string, Usage>> nodes;
+        for (const auto& entry : m_byContext)
+        {
+            std::string name = "no node";
+            if (entry.first < NodeList::GetNNodes())
+            {
+                name = Names::FindName(NodeList::GetNode(entry.first));
+                name = name.empty() ? "node " + std::to_string(entry.first) : name;
+            }
+            nodes.emplace_back(name, entry.second);
+        }
+        os << "Profile: " << m_events << " events, " << total << " s in event handlers"
+           << std::endl;
+        PrintTop(os, "event types", types, total, top);
+        PrintTop(os, "nodes", nodes, total, top);
+    }
+
+  private:
+    struct Usage
+    {
+        uint64_t events{0};
+        double seconds{0};
+    };
+
+    void Progress(Time simNow)
+    {
+        auto now = std::chrono::steady_clock::now();
+        double sinceLast = std::chrono::duration<double>(now - m_progressLast).count();
+        if (sinceLast < m_progressInterval)
+        {
+            return;
+        }
+        double wall = std::chrono::duration<double>(now - m_progressStart).count();
+        double ratio = simNow.GetSeconds() / wall;
+        std::cerr << "Progress: sim " << simNow.GetSeconds() << " s of "
+                  << m_progressStop.GetSeconds() << " s, wall " << wall << " s, " << ratio
+                  << " sim s/wall s, " << (m_events - m_progressLastEvents) / sinceLast
+                  << " events/s";
+        if (ratio > 0)
+        {
+            std::cerr << ", ETA " << (m_progressStop - simNow).GetSeconds() / ratio << " s";
+        }
+        std::cerr << std::endl;
+        m_progressLast = now;
+        m_progressLastEvents = m_events;
+    }
+
+    void Close(std::chrono::steady_clock::time_point now)
+    {
+        if (!m_running)
+        {
+            return;
+        }
+        double seconds = std::chrono::duration<double>(now - m_currentStart).count();
+        Usage& type = m_byType[m_currentType];
+        type.events++;
+        type.seconds += seconds;
+        Usage& context = m_byContext[m_currentContext];
+        context.events++;
+        context.seconds += seconds;
+    }
+
+    static std::string Demangle(const char* name)
+    {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+        std::string result = (status == 0) ? demangled : name;
+        std::free(demangled);
+        return result;
+    }
+
+    static void PrintTop(std::ostream& os,
+                         const std::string& title,
+                         std::vector<std::pair<std::string, Usage>>& usages,
+                         double total,
+                         uint32_t top)
+    {
+        std::sort(usages.begin(), usages.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second.seconds > rhs.second.seconds;
+        });
+        os << "  Top " << title << ":" << std::endl;
+        for (uint32_t i = 0; i < usages.size() && i < top; ++i)
+        {
+            os << "    " << usages[i].second.seconds << " s ("
+               << (total > 0 ? 100 * usages[i].second.seconds / total : 0) << "%), "
+               << usages[i].second.events << " events: " << usages[i].first << std::endl;
+        }
+    }
+
+    static InstrumentedScheduler* s_instance;
+
+    uint64_t m_events{0};
+    uint64_t m_pending{0};
+    bool m_profiling{false};
+    bool m_running{false};
+    std::type_index m_currentType{typeid(void)};
+    uint32_t m_currentContext{0};
+    std::chrono::steady_clock::time_point m_currentStart;
+    double m_progressInterval{0};
+    Time m_progressStop;
+    std::chrono::steady_clock::time_point m_progressStart;
+    std::chrono::steady_clock::time_point m_progressLast;
+    uint64_t m_progressLastEvents{0};
+    std::unordered_map<std::type_index, Usage> m_byType;
+    std::map<uint32_t, Usage> m_byContext;
+};
+
+InstrumentedScheduler* InstrumentedScheduler::s_instance = nullptr;
+
+NS_OBJECT_ENSURE_REGISTERED(InstrumentedScheduler);
+
+// Trace file that batches records into large page-aligned buffers and
+// writes all filled buffers with a single writev() call.
+class BatchedTraceFile
+{
+  public:
+    BatchedTraceFile(const std::string& filename, std::size_t bufferSize, uint32_t bufferCount)
+        : m_bufferSize(bufferSize)
+    {
+        // aligned_alloc needs a size that is a multiple of the alignment
+        NS_ABORT_MSG_IF(m_bufferSize == 0 || m_bufferSize % 4096 != 0,
+                        "Trace buffer size must be a positive multiple of 4096: " << m_bufferSize);
+        m_fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        NS_ABORT_MSG_IF(m_fd < 0, "Cannot open trace file " << filename);
+        m_buffers.resize(std::max<uint32_t>(bufferCount, 1));
+        for (auto& buffer : m_buffers)
+        {
+            buffer.data = static_cast<char*>(std::aligned_alloc(4096, m_bufferSize));
+            NS_ABORT_MSG_IF(!buffer.data,
+                            "Cannot allocate " << m_bufferSize << " bytes of trace buffer");
+        }
+    }
+
+    ~BatchedTraceFile()
+    {
+        Flush();
+        close(m_fd);
+        for (auto& buffer : m_buffers)
+        {
+            std::free(buffer.data);
+        }
+    }
+
+    void Append(const char* data, std::size_t size)
+    {
+        while (size > 0)
+        {
+            Buffer& buffer = m_buffers[m_current];
+            std::size_t chunk = std::min(size, m_bufferSize - buffer.used);
+            std::memcpy(buffer.data + buffer.used, data, chunk);
+            buffer.used += chunk;
+            data += chunk;
+            size -= chunk;
+            if (buffer.used == m_bufferSize && ++m_current == m_buffers.size())
+            {
+                Flush();
+            }
+        }
+    }
+
+    // Write every non-empty buffer with as few writev() calls as IOV_MAX
+    // allows, retrying partial writes.
+    void Flush()
+    {
+        std::vector<iovec> iov;
+        for (auto& buffer : m_buffers)
+        {
+            if (buffer.used > 0)
+            {
+                iov.push_back({buffer.data, buffer.used});
+            }
+        }
+        std::size_t next = 0;
+        while (next < iov.size())
+        {
+            int count = static_cast<int>(std::min<std::size_t>(iov.size() - next, IOV_MAX));
+            ssize_t written = writev(m_fd, iov.data() + next, count);
+            if (written < 0)
+            {
+                NS_ABORT_MSG_IF(errno != EINTR, "Trace write failed: " << std::strerror(errno));
+                continue;
+            }
+            m_writes++;
+            while (next < iov.size() && static_cast<std::size_t>(written) >= iov[next].iov_len)
+            {
+                written -= iov[next].iov_len;
+                next++;
+            }
+            if (next < iov.size())
+            {
+                iov[next].iov_base = static_cast<char*>(iov[next].iov_base) + written;
+                iov[next].iov_len -= written;
+            }
+        }
+        for (auto& buffer : m_buffers)
+        {
+            buffer.used = 0;
+        }
+        m_current = 0;
+    }
+
+    uint64_t GetWrites() const
+    {
+        return m_writes;
+    }
+
+    std::size_t GetAllocatedBytes() const
+    {
+        return m_bufferSize * m_buffers.size();
+    }
+
+  private:
+    struct Buffer
+    {
+        char* data{nullptr};
+        std::size_t used{0};
+    };
+
+    int m_fd;
+    std::size_t m_bufferSize;
+    std::vector<Buffer> m_buffers;
+    std::size_t m_current{0};
+    uint64_t m_writes{0};
+};
+
+// Stream buffer in front of either trace backend. It counts lines, bytes,
+// backend writes and the wall time spent in the backend the same way for
+// both. With the batched backend sync() does not write, so the std::endl of
+// the ASCII trace sinks does not defeat the batching; with the stream
+// backend every sync() flushes the std::filebuf.
+class TraceStreamBuf : public std::streambuf
+{
+  public:
+    explicit TraceStreamBuf(BatchedTraceFile* batched)
+        : m_batched(batched)
+    {
+    }
+
+    explicit TraceStreamBuf(std::filebuf* file)
+        : m_file(file)
+    {
+    }
+
+    // Write out whatever the backend still buffers.
+    void Flush()
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (m_batched)
+        {
+            m_batched->Flush();
+        }
+        else
+        {
+            m_file->pubsync();
+            m_flushes++;
+        }
+        m_writing += std::chrono::steady_clock::now() - start;
+    }
+
+    uint64_t GetLines() const
+    {
+        return m_lines;
+    }
+
+    uint64_t GetBytes() const
+    {
+        return m_bytes;
+    }
+
+    // writev() calls of the batched backend, flushes of the stream backend
+    uint64_t GetWrites() const
+    {
+        return m_batched ? m_batched->GetWrites() : m_flushes;
+    }
+
+    double GetWriteSeconds() const
+    {
+        return std::chrono::duration<double>(m_writing).count();
+    }
+
+  protected:
+    std::streamsize xsputn(const char* data, std::streamsize size) override
+    {
+        m_lines += std::count(data, data + size, '\n');
+        m_bytes += size;
+        auto start = std::chrono::steady_clock::now();
+        if (m_batched)
+        {
+            m_batched->Append(data, size);
+        }
+        else
+        {
+            size = m_file->sputn(data, size);
+        }
+        m_writing += std::chrono::steady_clock::now() - start;
+        return size;
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            char ch = traits_type::to_char_type(c);
+            if (xsputn(&ch, 1) != 1)
+            {
+                return traits_type::eof();
+            }
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        if (!m_batched)
+        {
+            Flush();
+        }
+        return 0;
+    }
+
+  private:
+    BatchedTraceFile* m_batched{nullptr};
+    std::filebuf* m_file{nullptr};
+    uint64_t m_lines{0};
+    uint64_t m_bytes{0};
+    uint64_t m_flushes{0};
+    std::chrono::steady_clock::duration m_writing{0};
+};
+
+// Output stream of a trace sink, either a plain std::filebuf ("stream") or
+// the batched writev backend ("batched"). Lines are only reported for text
+// traces.
+class TraceOutput
+{
+  public:
+    TraceOutput(const std::string& filename,
+                const std::string& backend,
+                std::size_t bufferSize,
+                uint32_t bufferCount,
+                bool text)
+        : m_filename(filename),
+          m_backend(backend),
+          m_text(text)
+    {
+        if (backend == "batched")
+        {
+            m_batched = std::make_unique<BatchedTraceFile>(filename, bufferSize, bufferCount);
+            m_streamBuf = std::make_unique<TraceStreamBuf>(m_batched.get());
+        }
+        else if (backend == "stream")
+        {
+            m_file = std::make_unique<std::filebuf>();
+            NS_ABORT_MSG_IF(!m_file->open(filename, std::ios::out | std::ios::binary),
+                            "Cannot open trace file " << filename);
+            m_streamBuf = std::make_unique<TraceStreamBuf>(m_file.get());
+        }
+        else
+        {
+            NS_FATAL_ERROR("Unknown trace backend: " << backend);
+        }
+        m_stream = std::make_unique<std::ostream>(m_streamBuf.get());
+    }
+
+    std::ostream* GetStream()
+    {
+        return m_stream.get();
+    }
+
+    std::size_t GetBufferBytes() const
+    {
+        return m_batched ? m_batched->GetAllocatedBytes() : 0;
+    }
+
+    void Flush()
+    {
+        m_streamBuf->Flush();
+    }
+
+    void Report(std::ostream& os, double wallSeconds) const
+    {
+        os << "Trace " << m_filename << " (" << m_backend << "): ";
+        if (m_text)
+        {
+            os << m_streamBuf->GetLines() << " lines, " << m_streamBuf->GetLines() / wallSeconds
+               << " lines/s, ";
+        }
+        os << m_streamBuf->GetBytes() << " bytes, " << m_streamBuf->GetWrites()
+           << (m_batched ? " writev calls, " : " flushes, ") << m_streamBuf->GetWriteSeconds()
+           << " s writing" << std::endl;
+    }
+
+  private:
+    std::string m_filename;
+    std::string m_backend;
+    bool m_text;
+    std::unique_ptr<BatchedTraceFile> m_batched;
+    std::unique_ptr<std::filebuf> m_file;
+    std::unique_ptr<TraceStreamBuf> m_streamBuf;
+    std::unique_ptr<std::ostream> m_stream;
+};
+
+// Frames written by a capture and the wall time spent writing them, so the
+// capture modes can be compared by write throughput.
+struct CaptureMeter
+{
+    uint64_t packets{0};
+    uint64_t bytes{0};
+    std::chrono::steady_clock::duration writing{0};
+};
+
+// Full capture: one promiscuous pcap file per device, named like
+// CsmaHelper::EnablePcapAll names them.
+class PcapCapture
+{
+  public:
+    PcapCapture(const std::string& prefix, CaptureMeter* meter)
+        : m_prefix(prefix),
+          m_meter(meter)
+    {
+    }
+
+    void Install(const NetDeviceContainer& devices)
+    {
+        PcapHelper pcapHelper;
+        for (auto it = devices.Begin(); it != devices.End(); ++it)
+        {
+            auto device = std::make_unique<DeviceFile>();
+            device->capture = this;
+            device->file =
+                pcapHelper.CreateFile(pcapHelper.GetFilenameFromDevice(m_prefix, *it, true),
+                                      std::ios::out,
+                                      PcapHelper::DLT_EN10MB);
+            (*it)->TraceConnectWithoutContext("PromiscSniffer",
+                                              MakeBoundCallback(&PcapCapture::Sniff,
+                                                                device.get()));
+            m_devices.push_back(std::move(device));
+        }
+    }
+
+  private:
+    struct DeviceFile
+    {
+        PcapCapture* capture;
+        Ptr<PcapFileWrapper> file;
+    };
+
+    static void Sniff(DeviceFile* device, Ptr<const Packet> packet)
+    {
+        CaptureMeter* meter = device->capture->m_meter;
+        auto start = std::chrono::steady_clock::now();
+        device->file->Write(Simulator::Now(), packet);
+        meter->writing += std::chrono::steady_clock::now() - start;
+        meter->packets++;
+        meter->bytes += packet->GetSize();
+    }
+
+    std::string m_prefix;
+    CaptureMeter* m_meter;
+    std::vector<std::unique_ptr<DeviceFile>> m_devices;
+};
+
+// Merged pcapng capture: a single sequentially written file in which every
+// device is one interface block, with writes batched in a buffer.
+class PcapngCapture
+{
+  public:
+    PcapngCapture(std::ostream* out, uint32_t bufferSize, CaptureMeter* meter)
+        : m_out(out),
+          m_bufferSize(bufferSize),
+          m_meter(meter)
+    {
+        m_buffer.reserve(bufferSize);
+        // Section header block
+        Put32(0x0A0D0D0A);
+        Put32(28);
+        Put32(0x1A2B3C4D);
+        Put16(1);
+        Put16(0);
+        Put32(0xFFFFFFFF); // Section length not specified
+        Put32(0xFFFFFFFF);
+        Put32(28);
+    }
+
+    ~PcapngCapture()
+    {
+        Flush();
+    }
+
+    // Add one interface description block per device and hook its sniffer.
+    void Install(const NetDeviceContainer& devices)
+    {
+        for (auto it = devices.Begin(); it != devices.End(); ++it)
+        {
+            auto iface = std::make_unique<Interface>();
+            iface->capture = this;
+            iface->id = m_interfaces.size();
+            WriteInterfaceBlock(Names::FindName((*it)->GetNode()) + "-" +
+                                std::to_string((*it)->GetIfIndex()));
+            (*it)->TraceConnectWithoutContext("PromiscSniffer",
+                                              MakeBoundCallback(&PcapngCapture::Sniff,
+                                                                iface.get()));
+            m_interfaces.push_back(std::move(iface));
+        }
+    }
+
+    void Flush()
+    {
+        auto start = std::chrono::steady_clock::now();
+        m_out->write(m_buffer.data(), m_buffer.size());
+        m_out->flush();
+        m_buffer.clear();
+        m_meter->writing += std::chrono::steady_clock::now() - start;
+    }
+
+  private:
+    struct Interface
+    {
+        PcapngCapture* capture;
+        uint32_t id;
+    };
+
+    static void Sniff(Interface* iface, Ptr<const Packet> packet)
+    {
+        iface->capture->WritePacket(iface->id, packet);
+    }
+
+    void WriteInterfaceBlock(const std::string& name)
+    {
+        uint32_t namePadded = (name.size() + 3) & ~3U;
+        uint32_t length = 16 + 4 + namePadded + 8 + 4 + 4;
+        Put32(1);
+        Put32(length);
+        Put16(1); // LINKTYPE_ETHERNET
+        Put16(0);
+        Put32(65535);
+        // if_name
+        Put16(2);
+        Put16(name.size());
+        PutBytes(reinterpret_cast<const uint8_t*>(name.data()), name.size());
+        m_buffer.resize(m_buffer.size() + namePadded - name.size(), 0);
+        // if_tsresol, nanoseconds
+        Put16(9);
+        Put16(1);
+        Put32(9);
+        // opt_endofopt
+        Put32(0);
+        Put32(length);
+    }
+
+    void WritePacket(uint32_t interfaceId, Ptr<const Packet> packet)
+    {
+        uint32_t size = packet->GetSize();
+        uint32_t padded = (size + 3) & ~3U;
+        uint32_t length = 32 + padded;
+        if (m_buffer.size() + length > m_bufferSize)
+        {
+            Flush();
+        }
+        auto start = std::chrono::steady_clock::now();
+        uint64_t timestamp = Simulator::Now().GetNanoSeconds();
+        Put32(6);
+        Put32(length);
+        Put32(interfaceId);
+        Put32(timestamp >> 32);
+        Put32(timestamp & 0xFFFFFFFF);
+        Put32(size);
+        Put32(size);
+        std::size_t offset = m_buffer.size();
+        m_buffer.resize(offset + padded, 0);
+        packet->CopyData(reinterpret_cast<uint8_t*>(m_buffer.data() + offset), size);
+        Put32(length);
+        m_meter->writing += std::chrono::steady_clock::now() - start;
+        m_meter->packets++;
+        m_meter->bytes += size;
+    }
+
+    void Put16(uint16_t value)
+    {
+        PutBytes(reinterpret_cast<const uint8_t*>(&value), sizeof(value));
+    }
+
+    void Put32(uint32_t value)
+    {
+        PutBytes(reinterpret_cast<const uint8_t*>(&value), sizeof(value));
+    }
+
+    void PutBytes(const uint8_t* data, std::size_t size)
+    {
+        std::size_t offset = m_buffer.size();
+        m_buffer.resize(offset + size);
+        std::memcpy(m_buffer.data() + offset, data, size);
+    }
+
+    std::ostream* m_out;
+    uint32_t m_bufferSize;
+    CaptureMeter* m_meter;
+    std::vector<char> m_buffer;
+    std::vector<std::unique_ptr<Interface>> m_interfaces;
+};
+
+static Rip::SplitHorizonType_e ParseSplitHorizon(const std::string& strategy)
+{
+    if (strategy == "NoSplitHorizon")
+    {
+        return Rip::NO_SPLIT_HORIZON;
+    }
+    if (strategy == "SplitHorizon")
+    {
+        return Rip::SPLIT_HORIZON;
+    }
+    if (strategy != "PoisonReverse")
+    {
+        NS_FATAL_ERROR("Unknown split horizon strategy: " << strategy);
+    }
+    return Rip::POISON_REVERSE;
+}
+
+// Snapshots of every router's RIP table, one JSON object per router and
+// snapshot time, e.g.
+// {"time":30,"node":"RouterA","routes":[{"dst":"10.0.6.0/24","gw":"10.0.1.2","metric":3,"if":2}]}
+class RoutingSnapshots
+{
+  public:
+    RoutingSnapshots(const std::string& filename, const NodeContainer& routers)
+        : m_out(filename)
+    {
+        for (auto it = routers.Begin(); it != routers.End(); ++it)
+        {
+            m_routers.emplace_back(Names::FindName(*it), GetRip(*it));
+        }
+    }
+
+    void ScheduleAt(Time at)
+    {
+        Simulator::Schedule(at, &RoutingSnapshots::Take, this);
+    }
+
+    void ScheduleEvery(Time interval, Time stop)
+    {
+        for (Time at = interval; at < stop; at += interval)
+        {
+            ScheduleAt(at);
+        }
+    }
+
+  private:
+    void Take()
+    {
+        for (const auto& router : m_routers)
+        {
+            m_out << "{\"time\":" << Simulator::Now().GetSeconds() << ",\"node\":\""
+                  << router.first << "\",\"routes\":[";
+            bool first = true;
+            for (const auto& route : CollectRipRoutes(router.second))
+            {
+                m_out << (first ? "" : ",") << "{\"dst\":\"" << route.destination << "/"
+                      << route.mask.GetPrefixLength() << "\",\"gw\":\"" << route.gateway
+                      << "\",\"metric\":" << route.metric << ",\"if\":" << route.interface
+                      << "}";
+                first = false;
+            }
+            m_out << "]}\n";
+        }
+    }
+
+    std::ofstream m_out;
+    std::vector<std::pair<std::string, Ptr<Rip>>> m_routers;
+};
+
+// Traffic classes used by the per-device statistics.
+enum TrafficClass
+{
+    TRAFFIC_RIP,
+    TRAFFIC_ICMP,
+    TRAFFIC_OTHER,
+    TRAFFIC_CLASSES
+};
+
+// Classify a packet that starts with its IPv4 header. Consumes the headers.
+static TrafficClass ClassifyIpv4(Ptr<Packet> packet)
+{
+    Ipv4Header ip;
+    packet->RemoveHeader(ip);
+    if (ip.GetProtocol() == 1)
+    {
+        return TRAFFIC_ICMP;
+    }
+    return IsRipPayload(ip, packet) ? TRAFFIC_RIP : TRAFFIC_OTHER;
+}
+
+// Classify a sniffed Ethernet frame as RIP, ICMP or anything else.
+static TrafficClass ClassifyFrame(Ptr<const Packet> frame)
+{
+    Ptr<Packet> copy = frame->Copy();
+    EthernetHeader ethernet;
+    copy->RemoveHeader(ethernet);
+    if (ethernet.GetLengthType() != 0x0800)
+    {
+        return TRAFFIC_OTHER;
+    }
+    return ClassifyIpv4(copy);
+}
+
+// Per-device packet and byte counters per time interval, split by traffic
+// class. Replaces the Wireshark I/O graph of each pcap with one CSV.
+class TrafficStats
+{
+  public:
+    explicit TrafficStats(Time interval)
+        : m_interval(interval)
+    {
+    }
+
+    void Install(const NetDeviceContainer& devices)
+    {
+        for (auto it = devices.Begin(); it != devices.End(); ++it)
+        {
+            auto device = std::make_unique<DeviceStats>();
+            device->stats = this;
+            device->name = Names::FindName((*it)->GetNode()) + "-" +
+                           std::to_string((*it)->GetIfIndex());
+            (*it)->TraceConnectWithoutContext("Sniffer",
+                                              MakeBoundCallback(&TrafficStats::Sniff,
+                                                                device.get()));
+            m_devices.push_back(std::move(device));
+        }
+    }
+
+    // Write one line per device and interval, empty intervals included.
+    void Write(const std::string& filename) const
+    {
+        std::ofstream out(filename);
+        out << "time,device,rip_packets,rip_bytes,icmp_packets,icmp_bytes,other_packets,"
+               "other_bytes\n";
+        std::size_t bins = 0;
+        for (const auto& device : m_devices)
+        {
+            bins = std::max(bins, device->bins.size());
+        }
+        for (std::size_t bin = 0; bin < bins; ++bin)
+        {
+            for (const auto& device : m_devices)
+            {
+                out << (m_interval * bin).GetSeconds() << "," << device->name;
+                for (uint32_t cls = 0; cls < TRAFFIC_CLASSES; ++cls)
+                {
+                    Counter counter;
+                    if (bin < device->bins.size())
+                    {
+                        counter = device->bins[bin][cls];
+                    }
+                    out << "," << counter.packets << "," << counter.bytes;
+                }
+                out << "\n";
+            }
+        }
+    }
+
+  private:
+    struct Counter
+    {
+        uint64_t packets{0};
+        uint64_t bytes{0};
+    };
+
+    struct DeviceStats
+    {
+        TrafficStats* stats;
+        std::string name;
+        std::vector<std::array<Counter, TRAFFIC_CLASSES>> bins;
+    };
+
+    static void Sniff(DeviceStats* device, Ptr<const Packet> packet)
+    {
+        std::size_t bin = Div(Simulator::Now(), device->stats->m_interval);
+        if (bin >= device->bins.size())
+        {
+            device->bins.resize(bin + 1);
+        }
+        Counter& counter = device->bins[bin][ClassifyFrame(packet)];
+        counter.packets++;
+        counter.bytes += packet->GetSize();
+    }
+
+    Time m_interval;
+    std::vector<std::unique_ptr<DeviceStats>> m_devices;
+};
+
+// Log-linear histogram of durations in microseconds: values below 16 get one
+// bucket each, above that every power of two is split in 8 buckets.
+class LogLinearHistogram
+{
+  public:
+    void Add(uint64_t value)
+    {
+        m_buckets[Bucket(value)]++;
+        m_count++;
+        m_max = std::max(m_max, value);
+    }
+
+    uint64_t GetCount() const
+    {
+        return m_count;
+    }
+
+    // Lower bound of the bucket holding the given quantile.
+    uint64_t Quantile(double quantile) const
+    {
+        uint64_t rank = quantile * m_count;
+        uint64_t seen = 0;
+        for (uint32_t bucket = 0; bucket < BUCKETS; ++bucket)
+        {
+            seen += m_buckets[bucket];
+            if (seen > rank)
+            {
+                return Lower(bucket);
+            }
+        }
+        return m_max;
+    }
+
+    uint64_t GetMax() const
+    {
+        return m_max;
+    }
+
+    // Call back with (lower, upper, count) of every non-empty bucket.
+    template <typename F>
+    void ForEach(F f) const
+    {
+        for (uint32_t bucket = 0; bucket < BUCKETS; ++bucket)
+        {
+            if (m_buckets[bucket] > 0)
+            {
+                f(Lower(bucket), Lower(bucket + 1), m_buckets[bucket]);
+            }
+        }
+    }
+
+  private:
+    static const uint32_t LINEAR = 16;
+    static const uint32_t SUB_BUCKETS = 8;
+    static const uint32_t BUCKETS = LINEAR + (64 - 4) * SUB_BUCKETS;
+
+    static uint32_t Bucket(uint64_t value)
+    {
+        if (value < LINEAR)
+        {
+            return value;
+        }
+        uint32_t exponent = 63 - __builtin_clzll(value);
+        uint32_t sub = (value >> (exponent - 3)) & (SUB_BUCKETS - 1);
+        return LINEAR + (exponent - 4) * SUB_BUCKETS + sub;
+    }
+
+    static uint64_t Lower(uint32_t bucket)
+    {
+        if (bucket < LINEAR)
+        {
+            return bucket;
+        }
+        uint32_t exponent = (bucket - LINEAR) / SUB_BUCKETS + 4;
+        uint64_t sub = (bucket - LINEAR) % SUB_BUCKETS;
+        return (uint64_t(SUB_BUCKETS) + sub) << (exponent - 3);
+    }
+
+    std::array<uint64_t, BUCKETS> m_buckets{};
+    uint64_t m_count{0};
+    uint64_t m_max{0};
+};
+
+// Multi-packet RIP updates per router: packets per update (the responses
+// Rip sends on one interface in the same event), gaps between consecutive
+// RIP frames of an update on the wire, and every RIP packet dropped on the
+// way, by where it was dropped.
+class RipBurstStats
+{
+  public:
+    explicit RipBurstStats(const NodeContainer& routers)
+    {
+        for (auto it = routers.Begin(); it != routers.End(); ++it)
+        {
+            auto router = std::make_unique<Router>();
+            router->name = Names::FindName(*it);
+            Ptr<Ipv4L3Protocol> ipv4 = (*it)->GetObject<Ipv4L3Protocol>();
+            ipv4->TraceConnectWithoutContext("Tx",
+                                             MakeBoundCallback(&RipBurstStats::Sent, router.get()));
+            ipv4->TraceConnectWithoutContext("Drop",
+                                             MakeBoundCallback(&RipBurstStats::Ipv4Drop,
+                                                               router.get()));
+            Ptr<TrafficControlLayer> tc = (*it)->GetObject<TrafficControlLayer>();
+            for (uint32_t i = 0; i < (*it)->GetNDevices(); ++i)
+            {
+                Ptr<NetDevice> device = (*it)->GetDevice(i);
+                if (!DynamicCast<CsmaNetDevice>(device))
+                {
+                    continue;
+                }
+                auto state = std::make_unique<Device>();
+                state->router = router.get();
+                state->device = device;
+                device->TraceConnectWithoutContext("PhyTxBegin",
+                                                   MakeBoundCallback(&RipBurstStats::WireTx,
+                                                                     state.get()));
+                device->TraceConnectWithoutContext("MacTxDrop",
+                                                   MakeBoundCallback(&RipBurstStats::DeviceDrop,
+                                                                     state.get()));
+                device->TraceConnectWithoutContext("PhyTxDrop",
+                                                   MakeBoundCallback(&RipBurstStats::DeviceDrop,
+                                                                     state.get()));
+                Ptr<QueueDisc> queueDisc = tc ? tc->GetRootQueueDiscOnDevice(device) : nullptr;
+                if (queueDisc)
+                {
+                    for (const char* trace : {"DropBeforeEnqueue", "DropAfterDequeue"})
+                    {
+                        queueDisc->TraceConnectWithoutContext(
+                            trace,
+                            MakeBoundCallback(&RipBurstStats::QueueDiscDrop, router.get()));
+                    }
+                }
+                router->devices.push_back(std::move(state));
+            }
+            m_routers.push_back(std::move(router));
+        }
+    }
+
+    void Report(std::ostream& os)
+    {
+        for (const auto& router : m_routers)
+        {
+            Flush(router.get());
+            os << "RIP updates " << router->name << ":";
+            for (const auto& entry : router->updateSizes)
+            {
+                os << " " << entry.second << "x" << entry.first;
+            }
+            os << " packets per update; dropped " << router->ipv4Drops << " at IPv4, "
+               << router->queueDiscDrops << " in the queue disc, " << router->deviceDrops
+               << " at the device" << std::endl;
+            if (router->gaps.GetCount() > 0)
+            {
+                os << "  Gaps between RIP frames of an update: median "
+                   << router->gaps.Quantile(0.5) << " us, p99 " << router->gaps.Quantile(0.99)
+                   << " us, max " << router->gaps.GetMax() << " us" << std::endl;
+            }
+        }
+    }
+
+  private:
+    struct Device;
+
+    struct Router
+    {
+        std::string name;
+        std::map<uint32_t, uint32_t> pending; // Interface to packets of the current update
+        Time lastSent;
+        std::map<uint32_t, uint64_t> updateSizes; // Packets per update to updates
+        LogLinearHistogram gaps; // Microseconds
+        uint64_t ipv4Drops{0};
+        uint64_t queueDiscDrops{0};
+        uint64_t deviceDrops{0};
+        std::vector<std::unique_ptr<Device>> devices;
+    };
+
+    struct Device
+    {
+        Router* router;
+        Ptr<NetDevice> device;
+        uint32_t outstanding{0}; // Frames of the current update not yet on the wire
+        Time lastFrame;
+    };
+
+    static void Flush(Router* router)
+    {
+        for (const auto& entry : router->pending)
+        {
+            router->updateSizes[entry.second]++;
+        }
+        router->pending.clear();
+    }
+
+    static void Sent(Router* router, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+    {
+        Ipv4Header ip;
+        RipHeader rip;
+        if (!ParseRip(packet, ip, rip) || rip.GetCommand() != RipHeader::RESPONSE)
+        {
+            return;
+        }
+        if (Simulator::Now() != router->lastSent)
+        {
+            Flush(router);
+            router->lastSent = Simulator::Now();
+        }
+        router->pending[interface]++;
+        Ptr<NetDevice> device = ipv4->GetNetDevice(interface);
+        for (auto& state : router->devices)
+        {
+            if (state->device == device)
+            {
+                state->outstanding++;
+            }
+        }
+    }
+
+    static void WireTx(Device* device, Ptr<const Packet> frame)
+    {
+        if (ClassifyFrame(frame) != TRAFFIC_RIP)
+        {
+            return;
+        }
+        Time now = Simulator::Now();
+        if (device->outstanding > 0)
+        {
+            device->outstanding--;
+            if (device->lastFrame.IsStrictlyPositive())
+            {
+                device->router->gaps.Add((now - device->lastFrame).GetMicroSeconds());
+            }
+        }
+        device->lastFrame = device->outstanding > 0 ? now : Time();
+    }
+
+    static void Ipv4Drop(Router* router,
+                         const Ipv4Header& header,
+                         Ptr<const Packet> packet,
+                         Ipv4L3Protocol::DropReason,
+                         Ptr<Ipv4>,
+                         uint32_t)
+    {
+        if (IsRipPayload(header, packet))
+        {
+            router->ipv4Drops++;
+        }
+    }
+
+    static void QueueDiscDrop(Router* router, Ptr<const QueueDiscItem> item, const char* reason)
+    {
+        Ptr<const Ipv4QueueDiscItem> ipv4Item = DynamicCast<const Ipv4QueueDiscItem>(item);
+        if (ipv4Item && IsRipPayload(ipv4Item->GetHeader(), item->GetPacket()) &&
+            std::strcmp(reason, EMPTY_RIP_RESPONSE_DROP) != 0)
+        {
+            router->queueDiscDrops++;
+        }
+    }
+
+    static void DeviceDrop(Device* device, Ptr<const Packet> packet)
+    {
+        if (ClassifyFrame(packet) == TRAFFIC_RIP)
+        {
+            device->router->deviceDrops++;
+            device->outstanding -= std::min(device->outstanding, 1u);
+        }
+    }
+
+    std::vector<std::unique_ptr<Router>> m_routers;
+};
+
+// Probe statistics of the ping application: RTTs go into a histogram, and
+// only the sequence numbers of the replies are kept. Lost probes and the
+// outage window of each topology event are derived at the end of the run.
+class PingStats
+{
+  public:
+    PingStats(Ptr<Application> ping, Time start, Time stop, Time interval, Time timeout)
+        : m_start(start),
+          m_interval(interval)
+    {
+        // Probes whose reply can still be outstanding at the stop time are not judged
+        m_probes = std::max<int64_t>(Div(stop - timeout - start, interval) + 1, 0);
+        m_received.resize(m_probes, false);
+        ping->TraceConnectWithoutContext("Rtt", MakeCallback(&PingStats::Rtt, this));
+    }
+
+    void AddEvent(Time at, const std::string& description)
+    {
+        m_events.emplace_back(at, description);
+    }
+
+    void Write(const std::string& filename) const
+    {
+        std::ofstream out(filename);
+        out << "record,a,b,c,d\n";
+        m_rtt.ForEach([&out](uint64_t lower, uint64_t upper, uint64_t count) {
+            out << "rtt_us," << lower << "," << upper << "," << count << ",\n";
+        });
+        for (const auto& outage : Outages())
+        {
+            out << "outage," << outage.description << "," << outage.firstLost.GetSeconds() << ",";
+            if (outage.recovered)
+            {
+                out << outage.firstRecovered.GetSeconds();
+            }
+            out << "," << outage.lost << "\n";
+        }
+    }
+
+    // Total time without answered probes after the topology events.
+    Time GetOutageTime() const
+    {
+        Time total;
+        for (const auto& outage : Outages())
+        {
+            total += outage.recovered ? outage.firstRecovered - outage.firstLost
+                                      : m_interval * outage.lost;
+        }
+        return total;
+    }
+
+    void Report(std::ostream& os) const
+    {
+        os << "Ping: " << m_rtt.GetCount() << " of " << m_probes << " probes answered, RTT p50 "
+           << m_rtt.Quantile(0.5) << " us, p99 " << m_rtt.Quantile(0.99) << " us, max "
+           << m_rtt.GetMax() << " us" << std::endl;
+        for (const auto& outage : Outages())
+        {
+            os << "  Outage after " << outage.description << ": first lost probe sent at "
+               << outage.firstLost.GetSeconds() << " s, ";
+            if (outage.recovered)
+            {
+                os << "first answered probe sent at " << outage.firstRecovered.GetSeconds()
+                   << " s (" << (outage.firstRecovered - outage.firstLost).GetSeconds() << " s, ";
+            }
+            else
+            {
+                os << "not recovered (";
+            }
+            os << outage.lost << " probes lost)" << std::endl;
+        }
+    }
+
+  private:
+    struct Outage
+    {
+        std::string description;
+        Time firstLost;
+        bool recovered{false};
+        Time firstRecovered;
+        uint32_t lost{0};
+    };
+
+    void Rtt(uint16_t seq, Time rtt)
+    {
+        if (seq < m_probes)
+        {
+            m_received[seq] = true;
+        }
+        m_rtt.Add(rtt.GetMicroSeconds());
+    }
+
+    // Each event's outage runs from the first lost probe sent after the event
+    // to the first answered probe after that, before the next event.
+    std::vector<Outage> Outages() const
+    {
+        std::vector<Outage> outages;
+        for (std::size_t i = 0; i < m_events.size(); ++i)
+        {
+            Time end = (i + 1 < m_events.size()) ? m_events[i + 1].first : Time::Max();
+            Outage outage;
+            outage.description = m_events[i].second;
+            bool lost = false;
+            for (uint32_t seq = 0; seq < m_probes; ++seq)
+            {
+                Time sent = m_start + m_interval * seq;
+                if (sent < m_events[i].first)
+                {
+                    continue;
+                }
+                if (sent >= end)
+                {
+                    break;
+                }
+                if (!m_received[seq])
+                {
+                    if (!lost)
+                    {
+                        outage.firstLost = sent;
+                    }
+                    lost = true;
+                    outage.lost++;
+                }
+                else if (lost)
+                {
+                    outage.recovered = true;
+                    outage.firstRecovered = sent;
+                    break;
+                }
+            }
+            if (lost)
+            {
+                outages.push_back(outage);
+            }
+        }
+        return outages;
+    }
+
+    Time m_start;
+    Time m_interval;
+    uint32_t m_probes;
+    std::vector<bool> m_received;
+    LogLinearHistogram m_rtt;
+    std::vector<std::pair<Time, std::string>> m_events;
+};
+
+// Samples memory use at a simulated time interval: process RSS and peak RSS,
+// node and device counts, pending events (with the InstrumentedScheduler)
+// and any number of named gauges such as routes or queued packets.
+class MemorySampler
+{
+  public:
+    using Gauge = std::function<uint64_t()>;
+
+    MemorySampler(const std::string& filename, Time interval)
+        : m_out(filename),
+          m_interval(interval)
+    {
+    }
+
+    void AddGauge(const std::string& name, Gauge gauge)
+    {
+        m_gauges.emplace_back(name, std::move(gauge));
+    }
+
+    void Start()
+    {
+        m_out << "time,rss_kb,peak_rss_kb,nodes,devices,pending_events";
+        for (const auto& gauge : m_gauges)
+        {
+            m_out << "," << gauge.first;
+        }
+        m_out << "\n";
+        Sample();
+    }
+
+    static uint64_t GetPeakRssKb()
+    {
+        return ReadStatus("VmHWM:");
+    }
+
+  private:
+    // Read a "kB" value of /proc/self/status, 0 where it does not exist.
+    static uint64_t ReadStatus(const std::string& key)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.compare(0, key.size(), key) == 0)
+            {
+                return std::stoull(line.substr(key.size()));
+            }
+        }
+        return 0;
+    }
+
+    void Sample()
+    {
+        uint64_t devices = 0;
+        for (uint32_t i = 0; i < NodeList::GetNNodes(); ++i)
+        {
+            devices += NodeList::GetNode(i)->GetNDevices();
+        }
+        InstrumentedScheduler* scheduler = InstrumentedScheduler::Get();
+        m_out << Simulator::Now().GetSeconds() << "," << ReadStatus("VmRSS:") << ","
+              << ReadStatus("VmHWM:") << "," << NodeList::GetNNodes() << "," << devices << ",";
+        if (scheduler)
+        {
+            m_out << scheduler->GetPendingEvents();
+        }
+        for (const auto& gauge : m_gauges)
+        {
+            m_out << "," << gauge.second();
+        }
+        m_out << "\n";
+        Simulator::Schedule(m_interval, &MemorySampler::Sample, this);
+    }
+
+    std::ofstream m_out;
+    Time m_interval;
+    std::vector<std::pair<std::string, Gauge>> m_gauges;
+};
+
+// BFD-style fast failure detection: both ends of a link send small hello
+// frames every interval. An end that hears nothing for "multiplier"
+// intervals sets its IPv4 interface down, which makes Rip invalidate the
+// routes through it at once, and sets it up again when hellos come back.
+class FastFailureDetector
+{
+  public:
+    static const uint16_t HELLO_PROTOCOL = 0x88B5; // IEEE local experimental EtherType
+
+    FastFailureDetector(Time interval, uint32_t multiplier)
+        : m_interval(interval),
+          m_multiplier(multiplier)
+    {
+    }
+
+    // Monitor the link between two devices.
+    void AddLink(Ptr<NetDevice> deviceA, Ptr<NetDevice> deviceB)
+    {
+        for (const auto& device : {deviceA, deviceB})
+        {
+            auto endpoint = std::make_unique<Endpoint>();
+            endpoint->detector = this;
+            endpoint->device = device;
+            endpoint->ipv4 = device->GetNode()->GetObject<Ipv4>();
+            endpoint->interface = endpoint->ipv4->GetInterfaceForDevice(device);
+            endpoint->name = Names::FindName(device->GetNode()) + "/" +
+                             std::to_string(endpoint->interface);
+            device->GetNode()->RegisterProtocolHandler(
+                MakeBoundCallback(&FastFailureDetector::HelloReceived, endpoint.get()),
+                HELLO_PROTOCOL,
+                device);
+            Simulator::Schedule(m_interval, &FastFailureDetector::SendHello, this, endpoint.get());
+            m_endpoints.push_back(std::move(endpoint));
+        }
+    }
+
+    void Report(std::ostream& os) const
+    {
+        for (const auto& endpoint : m_endpoints)
+        {
+            for (const auto& transition : endpoint->transitions)
+            {
+                os << "Fast detection: " << endpoint->name << (transition.second ? " up" : " down")
+                   << " at " << transition.first.GetSeconds() << " s" << std::endl;
+            }
+        }
+    }
+
+  private:
+    struct Endpoint
+    {
+        FastFailureDetector* detector;
+        Ptr<NetDevice> device;
+        Ptr<Ipv4> ipv4;
+        uint32_t interface;
+        std::string name;
+        Time lastHeard;
+        bool down{false};
+        std::vector<std::pair<Time, bool>> transitions; // Time, up
+    };
+
+    void SendHello(Endpoint* endpoint)
+    {
+        endpoint->device->Send(Create<Packet>(24), endpoint->device->GetBroadcast(), HELLO_PROTOCOL);
+        if (!endpoint->down && Simulator::Now() - endpoint->lastHeard > m_interval * m_multiplier)
+        {
+            endpoint->down = true;
+            endpoint->transitions.emplace_back(Simulator::Now(), false);
+            SetInterfaceState(endpoint->device->GetNode(), endpoint->interface, false);
+        }
+        Simulator::Schedule(m_interval, &FastFailureDetector::SendHello, this, endpoint);
+    }
+
+    static void HelloReceived(Endpoint* endpoint,
+                              Ptr<NetDevice> device,
+                              Ptr<const Packet>,
+                              uint16_t,
+                              const Address&,
+                              const Address&,
+                              NetDevice::PacketType)
+    {
+        endpoint->lastHeard = Simulator::Now();
+        if (endpoint->down)
+        {
+            endpoint->down = false;
+            endpoint->transitions.emplace_back(Simulator::Now(), true);
+            SetInterfaceState(endpoint->device->GetNode(), endpoint->interface, true);
+            if (g_triggeredRip)
+            {
+                // Give the other end the time to notice the link is back
+                FastFailureDetector* detector = endpoint->detector;
+                Simulator::Schedule(detector->m_interval * detector->m_multiplier,
+                                    &RequestFullTable,
+                                    device->GetNode(),
+                                    endpoint->interface);
+            }
+        }
+    }
+
+    Time m_interval;
+    uint32_t m_multiplier;
+    std::vector<std::unique_ptr<Endpoint>> m_endpoints;
+};
+
+// Acknowledged updates for --ripMode=triggered, after RFC 2091. A router
+// acknowledges every RIP response it receives with a small frame that lists
+// the prefix, mask and metric of each RTE it carried, and its own address.
+// The sender keeps the routes of each response per neighbor until that
+// neighbor acknowledged the same metric for them, and unicasts the
+// unacknowledged routes
+// again every retransmission interval, at most MAX_RETRANSMISSIONS times in
+// a row. A route sent again in a newer response replaces the pending one,
+// so a retransmission never undoes a later update.
+class RipUpdateAcks
+{
+  public:
+    static const uint16_t ACK_PROTOCOL = 0x88B6; // IEEE local experimental EtherType
+    static const uint32_t MAX_RETRANSMISSIONS = 10;
+
+    explicit RipUpdateAcks(Time interval)
+        : m_interval(interval)
+    {
+        g_interfaceListeners.push_back([this](Ptr<Node> node, uint32_t interface, bool up) {
+            if (!up)
+            {
+                InterfaceDown(node, interface);
+            }
+        });
+    }
+
+    void Install(Ptr<Node> node)
+    {
+        auto router = std::make_unique<Router>();
+        router->acks = this;
+        router->node = node;
+        router->name = Names::FindName(node);
+        Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>();
+        ipv4->TraceConnectWithoutContext("Tx", MakeBoundCallback(&RipUpdateAcks::Sent, router.get()));
+        ipv4->TraceConnectWithoutContext("Rx",
+                                         MakeBoundCallback(&RipUpdateAcks::Received, router.get()));
+        for (uint32_t interface = 1; interface < ipv4->GetNInterfaces(); ++interface)
+        {
+            node->RegisterProtocolHandler(MakeBoundCallback(&RipUpdateAcks::AckReceived,
+                                                            router.get()),
+                                          ACK_PROTOCOL,
+                                          ipv4->GetNetDevice(interface));
+        }
+        m_routerOf[node->GetId()] = router.get();
+        m_routers.push_back(std::move(router));
+    }
+
+    void Report(std::ostream& os) const
+    {
+        for (const auto& router : m_routers)
+        {
+            os << "RIP acks " << router->name << ": " << router->acksSent << " sent, "
+               << router->acksReceived << " received, " << router->retransmissions
+               << " retransmitted responses, " << router->givenUp << " routes given up"
+               << std::endl;
+        }
+    }
+
+  private:
+    using PrefixKey = std::pair<uint32_t, uint32_t>;
+
+    // Routes sent to one neighbor and not acknowledged yet
+    struct Neighbor
+    {
+        uint32_t interface;
+        std::map<PrefixKey, RipRte> pending;
+        uint32_t retransmissions{0};
+        EventId retransmit;
+    };
+
+    struct Router
+    {
+        RipUpdateAcks* acks;
+        Ptr<Node> node;
+        std::string name;
+        std::map<uint32_t, std::vector<Ipv4Address>> ripNeighbors; // By interface
+        std::map<uint32_t, Neighbor> neighbors;                    // By address
+        uint64_t acksSent{0};
+        uint64_t acksReceived{0};
+        uint64_t retransmissions{0};
+        uint64_t givenUp{0};
+    };
+
+    // The RIP routers on the link of an interface.
+    static const std::vector<Ipv4Address>& GetRipNeighbors(Router* router, uint32_t interface)
+    {
+        auto found = router->ripNeighbors.find(interface);
+        if (found == router->ripNeighbors.end())
+        {
+            std::vector<Ipv4Address> addresses;
+            for (const auto& neighbor : GetLinkNeighbors(router->node, interface))
+            {
+                if (GetRip(neighbor.first))
+                {
+                    addresses.push_back(neighbor.second);
+                }
+            }
+            found = router->ripNeighbors.emplace(interface, addresses).first;
+        }
+        return found->second;
+    }
+
+    static void Sent(Router* router, Ptr<const Packet> packet, Ptr<Ipv4>, uint32_t interface)
+    {
+        Ipv4Header ip;
+        RipHeader rip;
+        if (!ParseRip(packet, ip, rip) || rip.GetCommand() != RipHeader::RESPONSE)
+        {
+            return;
+        }
+        std::vector<Ipv4Address> destinations;
+        if (ip.GetDestination().IsMulticast())
+        {
+            destinations = GetRipNeighbors(router, interface);
+        }
+        else
+        {
+            destinations.push_back(ip.GetDestination());
+        }
+        std::list<RipRte> rtes = rip.GetRteList();
+        for (const auto& address : destinations)
+        {
+            Neighbor& neighbor = router->neighbors[address.Get()];
+            neighbor.interface = interface;
+            for (const auto& rte : rtes)
+            {
+                PrefixKey key(rte.GetPrefix().Get(), rte.GetSubnetMask().Get());
+                neighbor.pending[key] = rte;
+            }
+            if (!neighbor.pending.empty() && !neighbor.retransmit.IsPending())
+            {
+                neighbor.retransmit = Simulator::Schedule(router->acks->m_interval,
+                                                          &RipUpdateAcks::Retransmit,
+                                                          router,
+                                                          address);
+            }
+        }
+    }
+
+    static void Received(Router* router, Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+    {
+        Ipv4Header ip;
+        RipHeader rip;
+        if (!ParseRip(packet, ip, rip) || rip.GetCommand() != RipHeader::RESPONSE)
+        {
+            return;
+        }
+        // Own address, then prefix, mask and metric of every RTE
+        std::vector<uint32_t> ack;
+        ack.push_back(ipv4->GetAddress(interface, 0).GetLocal().Get());
+        for (const auto& rte : rip.GetRteList())
+        {
+            ack.push_back(rte.GetPrefix().Get());
+            ack.push_back(rte.GetSubnetMask().Get());
+            ack.push_back(rte.GetRouteMetric());
+        }
+        Ptr<NetDevice> device = ipv4->GetNetDevice(interface);
+        Ptr<Packet> frame = Create<Packet>(reinterpret_cast<const uint8_t*>(ack.data()),
+                                           ack.size() * sizeof(uint32_t));
+        Simulator::ScheduleNow(&RipUpdateAcks::SendAck, device, frame);
+        router->acksSent++;
+    }
+
+    static void SendAck(Ptr<NetDevice> device, Ptr<Packet> ack)
+    {
+        device->Send(ack, device->GetBroadcast(), ACK_PROTOCOL);
+    }
+
+    static void AckReceived(Router* router,
+                            Ptr<NetDevice>,
+                            Ptr<const Packet> packet,
+                            uint16_t,
+                            const Address&,
+                            const Address&,
+                            NetDevice::PacketType)
+    {
+        // CSMA pads short frames, so the RTE count comes from the whole words
+        std::vector<uint32_t> ack(packet->GetSize() / sizeof(uint32_t));
+        packet->CopyData(reinterpret_cast<uint8_t*>(ack.data()), ack.size() * sizeof(uint32_t));
+        if (ack.empty())
+        {
+            return;
+        }
+        auto neighbor = router->neighbors.find(ack[0]);
+        if (neighbor == router->neighbors.end())
+        {
+            return;
+        }
+        router->acksReceived++;
+        auto& pending = neighbor->second.pending;
+        for (std::size_t i = 1; i + 2 < ack.size(); i += 3)
+        {
+            // A route sent again with another metric stays pending
+            auto route = pending.find(PrefixKey(ack[i], ack[i + 1]));
+            if (route != pending.end() && route->second.GetRouteMetric() == ack[i + 2])
+            {
+                pending.erase(route);
+            }
+        }
+        if (pending.empty())
+        {
+            neighbor->second.retransmit.Cancel();
+            neighbor->second.retransmissions = 0;
+        }
+    }
+
+    static void Retransmit(Router* router, Ipv4Address address)
+    {
+        Neighbor& neighbor = router->neighbors[address.Get()];
+        if (neighbor.pending.empty())
+        {
+            return;
+        }
+        if (neighbor.retransmissions == MAX_RETRANSMISSIONS)
+        {
+            router->givenUp += neighbor.pending.size();
+            neighbor.pending.clear();
+            neighbor.retransmissions = 0;
+            return;
+        }
+        neighbor.retransmissions++;
+        // Sent() records the new packets, which also schedules the next round
+        std::vector<RipRte> rtes;
+        for (const auto& entry : neighbor.pending)
+        {
+            rtes.push_back(entry.second);
+        }
+        for (std::size_t first = 0; first < rtes.size(); first += 25)
+        {
+            RipHeader response;
+            response.SetCommand(RipHeader::RESPONSE);
+            for (std::size_t i = first; i < std::min(rtes.size(), first + 25); ++i)
+            {
+                response.AddRte(rtes[i]);
+            }
+            SendRipTo(router->node, neighbor.interface, address, response);
+            router->retransmissions++;
+        }
+        if (!neighbor.retransmit.IsPending())
+        {
+            neighbor.retransmit = Simulator::Schedule(router->acks->m_interval,
+                                                      &RipUpdateAcks::Retransmit,
+                                                      router,
+                                                      address);
+        }
+    }
+
+    // Rip withdraws everything learned over a failed interface on its own,
+    // and on recovery the tables are exchanged again.
+    void InterfaceDown(Ptr<Node> node, uint32_t interface)
+    {
+        auto router = m_routerOf.find(node->GetId());
+        if (router == m_routerOf.end())
+        {
+            return;
+        }
+        for (auto& entry : router->second->neighbors)
+        {
+            if (entry.second.interface == interface)
+            {
+                entry.second.pending.clear();
+                entry.second.retransmissions = 0;
+                entry.second.retransmit.Cancel();
+            }
+        }
+    }
+
+    Time m_interval;
+    std::vector<std::unique_ptr<Router>> m_routers;
+    std::map<uint32_t, Router*> m_routerOf; // By node id
+};
+
+// Lookups per second of the prefix trie against a linear longest prefix
+// scan, for each comma separated table size. Prefixes are random, most of
+// them /24; half of the looked up addresses fall into a table prefix.
+static int RunLpmBenchmark(const std::string& sizes)
+{
+    std::mt19937 random(1);
+    std::istringstream list(sizes);
+    std::string size;
+    while (std::getline(list, size, ','))
+    {
+        uint32_t routes = std::stoul(size);
+        std::uniform_int_distribution<uint32_t> address;
+        std::uniform_int_distribution<uint16_t> length(8, 32);
+        std::vector<std::pair<Ipv4Address, Ipv4Mask>> prefixes;
+        PrefixTrie<uint32_t> trie;
+        for (uint32_t i = 0; i < routes; ++i)
+        {
+            uint16_t bits = (random() % 10 < 6) ? 24 : length(random);
+            Ipv4Mask mask(0xFFFFFFFFu << (32 - bits));
+            Ipv4Address prefix = Ipv4Address(address(random)).CombineMask(mask);
+            trie.Insert(prefix, mask, bits);
+            prefixes.emplace_back(prefix, mask);
+        }
+        std::vector<Ipv4Address> destinations(1 << 20);
+        for (auto& destination : destinations)
+        {
+            uint32_t host = address(random);
+            if (random() % 2 == 0)
+            {
+                const auto& prefix = prefixes[random() % prefixes.size()];
+                host = prefix.first.Get() | (host & prefix.second.GetInverse());
+            }
+            destination = Ipv4Address(host);
+        }
+
+        uint64_t matched = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& destination : destinations)
+        {
+            const uint32_t* bits = trie.Lookup(destination);
+            matched += bits ? *bits : 0;
+        }
+        std::chrono::duration<double> trieWall = std::chrono::steady_clock::now() - start;
+
+        // The linear scan gets fewer lookups, about 2^27 prefix comparisons
+        std::size_t linearLookups =
+            std::min(destinations.size(), std::max<std::size_t>(1000, (1u << 27) / routes));
+        std::vector<int32_t> linear(linearLookups); // Matched prefix length, -1 for none
+        start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < linearLookups; ++i)
+        {
+            uint16_t best = 0;
+            bool found = false;
+            for (const auto& prefix : prefixes)
+            {
+                if (prefix.second.IsMatch(prefix.first, destinations[i]) &&
+                    (!found || prefix.second.GetPrefixLength() > best))
+                {
+                    best = prefix.second.GetPrefixLength();
+                    found = true;
+                }
+            }
+            linear[i] = found ? best : -1;
+        }
+        std::chrono::duration<double> linearWall = std::chrono::steady_clock::now() - start;
+        for (std::size_t i = 0; i < linearLookups; ++i)
+        {
+            const uint32_t* bits = trie.Lookup(destinations[i]);
+            NS_ABORT_MSG_IF(linear[i] != (bits ? static_cast<int32_t>(*bits) : -1),
+                            "Trie and linear scan disagree for " << destinations[i]);
+        }
+
+        std::cout << "LPM benchmark " << trie.GetSize() << " routes: trie "
+                  << destinations.size() / trieWall.count() << " lookups/s, linear scan "
+                  << linearLookups / linearWall.count() << " lookups/s (checksum " << matched
+                  << ")" << std::endl;
+    }
+    return 0;
+}
+
+// Compare incremental and full SPF on grids of the given comma separated
+// router counts with random link costs. Trees are kept for a random sample
+// of sources, 12 bytes per source and router, and every repair is checked
+// against a full computation of the same trees: the time of both and the
+// number of trees changed when single links fail and come back.
+static int RunSpfBenchmark(const std::string& sizes, uint32_t sources)
+{
+    std::mt19937 random(1);
+    std::istringstream list(sizes);
+    std::string size;
+    while (std::getline(list, size, ','))
+    {
+        uint32_t side = std::max<uint32_t>(2, std::lround(std::sqrt(std::stod(size))));
+        SpfGraph graph;
+        for (uint32_t i = 0; i < side * side; ++i)
+        {
+            graph.AddRouter();
+        }
+        std::uniform_int_distribution<uint32_t> cost(1, 10);
+        std::vector<std::pair<uint32_t, uint32_t>> edges; // Both directions of a grid edge
+        for (uint32_t row = 0; row < side; ++row)
+        {
+            for (uint32_t col = 0; col < side; ++col)
+            {
+                uint32_t router = row * side + col;
+                for (uint32_t neighbor : {router + 1, router + side})
+                {
+                    if ((neighbor == router + 1 && col + 1 == side) || neighbor >= side * side)
+                    {
+                        continue;
+                    }
+                    uint32_t forward = graph.AddLink(router, neighbor, cost(random));
+                    uint32_t backward = graph.AddLink(neighbor, router, cost(random));
+                    edges.emplace_back(forward, backward);
+                }
+            }
+        }
+
+        std::vector<uint32_t> sampled(graph.GetNRouters());
+        std::iota(sampled.begin(), sampled.end(), 0);
+        std::shuffle(sampled.begin(), sampled.end(), random);
+        sampled.resize(std::min<std::size_t>(sources, sampled.size()));
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t source : sampled)
+        {
+            graph.AddSource(source);
+        }
+        std::chrono::duration<double, std::milli> initial = std::chrono::steady_clock::now() - start;
+
+        // Times a full computation of the kept trees and aborts unless the
+        // repaired trees have the same distances.
+        auto checkRepair = [&graph, &sampled]() {
+            std::vector<uint32_t> repaired;
+            for (uint32_t source : sampled)
+            {
+                for (uint32_t router = 0; router < graph.GetNRouters(); ++router)
+                {
+                    repaired.push_back(graph.GetDistance(source, router));
+                }
+            }
+            auto start = std::chrono::steady_clock::now();
+            graph.Recompute();
+            std::chrono::duration<double, std::milli> full = std::chrono::steady_clock::now() - start;
+            std::size_t i = 0;
+            for (uint32_t source : sampled)
+            {
+                for (uint32_t router = 0; router < graph.GetNRouters(); ++router)
+                {
+                    NS_ABORT_MSG_IF(graph.GetDistance(source, router) != repaired[i++],
+                                    "Repaired and full SPF disagree from " << source << " to "
+                                                                           << router);
+                }
+            }
+            return full.count();
+        };
+
+        const uint32_t failures = 20;
+        std::uniform_int_distribution<std::size_t> pick(0, edges.size() - 1);
+        double downMs = 0;
+        double upMs = 0;
+        double fullDownMs = 0;
+        double fullUpMs = 0;
+        uint64_t downTrees = 0;
+        uint64_t upTrees = 0;
+        for (uint32_t i = 0; i < failures; ++i)
+        {
+            const auto& edge = edges[pick(random)];
+            std::vector<uint32_t> links{edge.first, edge.second};
+            start = std::chrono::steady_clock::now();
+            downTrees += graph.SetLinks(links, false).size();
+            std::chrono::duration<double, std::milli> down = std::chrono::steady_clock::now() - start;
+            fullDownMs += checkRepair();
+            start = std::chrono::steady_clock::now();
+            upTrees += graph.SetLinks(links, true).size();
+            std::chrono::duration<double, std::milli> up = std::chrono::steady_clock::now() - start;
+            fullUpMs += checkRepair();
+            downMs += down.count();
+            upMs += up.count();
+        }
+        std::cout << "SPF benchmark " << graph.GetNRouters() << " routers, " << graph.GetNLinks()
+                  << " links, " << graph.GetNTrees() << " trees ("
+                  << 12.0 * graph.GetNTrees() * graph.GetNRouters() / 1e6 << " MB): initial "
+                  << initial.count() << " ms; link down full " << fullDownMs / failures
+                  << " ms, repaired " << downMs / failures << " ms (" << downTrees / failures
+                  << " trees changed); link up full " << fullUpMs / failures << " ms, repaired "
+                  << upMs / failures << " ms (" << upTrees / failures << " trees changed)"
+                  << std::endl;
+    }
+    return 0;
+}
+
+static void CountForwarded(std::pair<uint64_t, uint64_t>* forwarded,
+                           Ptr<Ipv4Route> route,
+                           Ptr<const Packet>,
+                           const Ipv4Header&)
+{
+    forwarded->first++;
+    forwarded->second += route->GetGateway().Get();
+}
+
+// Time the forwarding decision of a router for the given comma separated
+// numbers of learned routes: Rip's RouteInput against RipLpmRouting. A
+// neighbor announces the routes over RIP, as /24s from 20.0.0.0 up, both
+// learn them from the responses, and the router forwards packets to random
+// addresses in them. The trie's share of handling the responses is timed
+// as well, per RTE, for responses that only refresh the routes and for
+// responses that change every metric.
+static int RunForwardingBenchmark(const std::string& sizes)
+{
+    std::mt19937 random(1);
+    // The i-th announced /24, skipping 127.0.0.0/8
+    auto prefixOf = [](uint32_t i) {
+        uint32_t block = 20 + (i >> 16);
+        block += (block >= 127) ? 1 : 0;
+        return (block << 24) | ((i & 0xFFFF) << 8);
+    };
+    std::istringstream list(sizes);
+    std::string size;
+    while (std::getline(list, size, ','))
+    {
+        uint32_t routes = std::stoul(size);
+        NS_ABORT_MSG_IF(routes == 0 || routes > (224u - 21) << 16,
+                        "Between 1 and " << ((224u - 21) << 16)
+                                         << " routes, the unicast /24s from 20.0.0.0");
+        NodeContainer nodes;
+        nodes.Create(3); // Router, neighbor announcing the routes, packet source
+        RipHelper ripRouting;
+        Ipv4ListRoutingHelper listRouting;
+        listRouting.Add(ripRouting, 0);
+        InternetStackHelper internet;
+        internet.SetIpv6StackInstall(false);
+        internet.SetRoutingHelper(listRouting);
+        internet.Install(nodes);
+        CsmaHelper csma;
+        NetDeviceContainer toNeighbor = csma.Install(NodeContainer(nodes.Get(0), nodes.Get(1)));
+        NetDeviceContainer toSource = csma.Install(NodeContainer(nodes.Get(0), nodes.Get(2)));
+        Ipv4AddressHelper addresses;
+        addresses.SetBase(Ipv4Address("10.0.0.0"), Ipv4Mask("255.255.255.0"));
+        Ipv4InterfaceContainer neighborInterfaces = addresses.Assign(toNeighbor);
+        addresses.SetBase(Ipv4Address("10.0.1.0"), Ipv4Mask("255.255.255.0"));
+        addresses.Assign(toSource);
+
+        Ptr<Node> router = nodes.Get(0);
+        Ptr<Ipv4> ipv4 = router->GetObject<Ipv4>();
+        Ptr<RipLpmRouting> lpm = CreateObject<RipLpmRouting>();
+        DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol())->AddRoutingProtocol(lpm, 5);
 
-using namespace ns3;
+        const uint32_t perMessage = 25;
+        std::vector<RipHeader> responses;
+        for (uint32_t first = 0; first < routes; first += perMessage)
+        {
+            RipHeader response;
+            response.SetCommand(RipHeader::RESPONSE);
+            for (uint32_t i = first; i < routes && i < first + perMessage; ++i)
+            {
+                RipRte rte;
+                rte.SetPrefix(Ipv4Address(prefixOf(i)));
+                rte.SetSubnetMask(Ipv4Mask("255.255.255.0"));
+                rte.SetRouteTag(0);
+                rte.SetRouteMetric(1);
+                response.AddRte(rte);
+            }
+            // Spaced so the device queues never fill
+            Simulator::Schedule(Seconds(1) + MicroSeconds(10 * responses.size()),
+                                &SendRipTo,
+                                nodes.Get(1),
+                                1,
+                                neighborInterfaces.GetAddress(0),
+                                response);
+            responses.push_back(response);
+        }
+        Simulator::Stop(Seconds(2) + MicroSeconds(10 * responses.size()));
+        Simulator::Run();
+        Ptr<Rip> rip = GetRip(router);
+        NS_ABORT_MSG_IF(lpm->GetNRoutes() < routes,
+                        "The router learned " << lpm->GetNRoutes() << " of " << routes << " routes");
 
-NS_LOG_COMPONENT_DEFINE("RipSimpleRouting");
+        const uint32_t packets = 10000;
+        std::uniform_int_distribution<uint32_t> pick(0, routes - 1);
+        std::uniform_int_distribution<uint32_t> host(1, 254);
+        std::vector<Ipv4Header> headers(packets);
+        for (auto& header : headers)
+        {
+            header.SetSource(Ipv4Address("10.0.1.2"));
+            header.SetDestination(Ipv4Address(prefixOf(pick(random)) | host(random)));
+            header.SetProtocol(17);
+            header.SetTtl(64);
+        }
+        Ptr<const Packet> packet = Create<Packet>(64);
+        Ptr<const NetDevice> idev = toSource.Get(0);
+        // Time one protocol forwarding every packet, in ns per packet
+        auto run = [&headers, &packet, &idev](Ptr<Ipv4RoutingProtocol> protocol,
+                                              std::pair<uint64_t, uint64_t>& forwarded) {
+            Ipv4RoutingProtocol::UnicastForwardCallback ucb =
+                MakeBoundCallback(&CountForwarded, &forwarded);
+            Ipv4RoutingProtocol::MulticastForwardCallback mcb;
+            Ipv4RoutingProtocol::LocalDeliverCallback lcb;
+            Ipv4RoutingProtocol::ErrorCallback ecb;
+            auto start = std::chrono::steady_clock::now();
+            for (const auto& header : headers)
+            {
+                protocol->RouteInput(packet, header, idev, ucb, mcb, lcb, ecb);
+            }
+            std::chrono::duration<double, std::nano> wall = std::chrono::steady_clock::now() - start;
+            return wall.count() / headers.size();
+        };
+        std::pair<uint64_t, uint64_t> ripForwarded(0, 0);
+        std::pair<uint64_t, uint64_t> lpmForwarded(0, 0);
+        double ripNs = run(rip, ripForwarded);
+        double lpmNs = run(lpm, lpmForwarded);
+        NS_ABORT_MSG_IF(ripForwarded != lpmForwarded, "Rip and the trie forward differently");
 
-// Global pointer to animation interface
-AnimationInterface* g_anim = nullptr;
+        // Time the trie handling every response again, in ns per RTE
+        auto sync = [&responses, &lpm, &neighborInterfaces, routes]() {
+            auto start = std::chrono::steady_clock::now();
+            for (const auto& response : responses)
+            {
+                lpm->HandleResponse(response, neighborInterfaces.GetAddress(1), 1);
+            }
+            std::chrono::duration<double, std::nano> wall = std::chrono::steady_clock::now() - start;
+            return wall.count() / routes;
+        };
+        double refreshNs = sync();
+        for (auto& response : responses)
+        {
+            auto rtes = response.GetRteList();
+            response.ClearRtes();
+            for (auto& rte : rtes)
+            {
+                rte.SetRouteMetric(2);
+                response.AddRte(rte);
+            }
+        }
+        double changeNs = sync();
 
-void TearDownLink(Ptr<Node> nodeA, Ptr<Node> nodeB, uint32_t interfaceA, uint32_t interfaceB)
+        std::cout << "Forwarding benchmark " << lpm->GetNRoutes() << " routes: Rip " << ripNs
+                  << " ns/packet, trie " << lpmNs << " ns/packet (" << lpmForwarded.first
+                  << " of " << packets << " forwarded); trie sync " << refreshNs
+                  << " ns/RTE refreshed, " << changeNs << " ns/RTE changed" << std::endl;
+        Simulator::Destroy();
+    }
+    return 0;
+}
+
+// Packet recording for the "full" animation mode. With a sampling interval,
+// packets are only recorded during the first `window` of every interval, by
+// moving the animation's tracing window. Once `maxPackets` packets have been
+// recorded, packet tracing stops; node updates are still recorded.
+class AnimPacketSampler
 {
-    nodeA->GetObject<Ipv4>()->SetDown(interfaceA);
-    nodeB->GetObject<Ipv4>()->SetDown(interfaceB);
-    
-    // Visualize link failure in animation
-    if (g_anim) {
-        std::string description = "Link Down";
-        g_anim->UpdateNodeColor(nodeA, 255, 0, 0); // Red for failed node
-        g_anim->UpdateNodeColor(nodeB, 255, 0, 0);
-        g_anim->UpdateNodeDescription(nodeA, description);
-        g_anim->UpdateNodeDescription(nodeB, description);
+  public:
+    AnimPacketSampler(AnimationInterface* anim, uint64_t maxPackets, Time interval, Time window)
+        : m_anim(anim),
+          m_maxPackets(maxPackets),
+          m_interval(interval),
+          m_window(window)
+    {
+        if (m_interval.IsStrictlyPositive())
+        {
+            m_next = Simulator::ScheduleNow(&AnimPacketSampler::OpenWindow, this);
+        }
+        if (m_maxPackets > 0)
+        {
+            Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::CsmaNetDevice/PhyTxBegin",
+                                          MakeCallback(&AnimPacketSampler::Count, this));
+        }
+    }
+
+  private:
+    void OpenWindow()
+    {
+        m_windowEnd = Simulator::Now() + m_window;
+        m_anim->SetStartTime(Simulator::Now());
+        m_anim->SetStopTime(m_windowEnd);
+        m_next = Simulator::Schedule(m_interval, &AnimPacketSampler::OpenWindow, this);
+    }
+
+    void Count(Ptr<const Packet>)
+    {
+        if (m_interval.IsStrictlyPositive() && Simulator::Now() > m_windowEnd)
+        {
+            return; // Not recorded by the animation
+        }
+        if (++m_packets == m_maxPackets)
+        {
+            m_anim->SetStopTime(Simulator::Now());
+            m_next.Cancel();
+        }
+    }
+
+    AnimationInterface* m_anim;
+    uint64_t m_maxPackets;
+    Time m_interval;
+    Time m_window;
+    Time m_windowEnd;
+    uint64_t m_packets{0};
+    EventId m_next;
+};
+
+// Windowed pcap capture: every device keeps a short in-memory ring of the
+// frames it sniffed, and frames are only written to disk inside a window
+// around each scheduled topology event.
+class WindowedPcapCapture
+{
+  public:
+    WindowedPcapCapture(const std::string& prefix,
+                        Time before,
+                        Time after,
+                        uint32_t ringSize,
+                        CaptureMeter* meter)
+        : m_prefix(prefix),
+          m_before(before),
+          m_after(after),
+          m_ringSize(ringSize),
+          m_meter(meter)
+    {
+    }
+
+    // Hook the promiscuous sniffer of every device in the container.
+    void Install(const NetDeviceContainer& devices)
+    {
+        for (auto it = devices.Begin(); it != devices.End(); ++it)
+        {
+            auto ring = std::make_unique<DeviceRing>();
+            ring->capture = this;
+            ring->device = *it;
+            (*it)->TraceConnectWithoutContext("PromiscSniffer",
+                                              MakeBoundCallback(&WindowedPcapCapture::Sniff,
+                                                                ring.get()));
+            m_rings.push_back(std::move(ring));
+        }
     }
+
+    // Open a capture window around a topology event scheduled at the given time.
+    void AddEvent(Time at)
+    {
+        Simulator::Schedule(at, &WindowedPcapCapture::OpenWindow, this);
+    }
+
+    uint64_t GetSeenPackets() const
+    {
+        return m_seen;
+    }
+
+    uint64_t GetRingBytes() const
+    {
+        uint64_t bytes = 0;
+        for (const auto& ring : m_rings)
+        {
+            for (const auto& entry : ring->packets)
+            {
+                bytes += entry.second->GetSize();
+            }
+        }
+        return bytes;
+    }
+
+  private:
+    struct DeviceRing
+    {
+        WindowedPcapCapture* capture;
+        Ptr<NetDevice> device;
+        Ptr<PcapFileWrapper> file;
+        std::deque<std::pair<Time, Ptr<const Packet>>> packets;
+    };
+
+    static void Sniff(DeviceRing* ring, Ptr<const Packet> packet)
+    {
+        WindowedPcapCapture* capture = ring->capture;
+        capture->m_seen++;
+        Time now = Simulator::Now();
+        if (now <= capture->m_windowEnd)
+        {
+            capture->Write(ring, now, packet);
+            return;
+        }
+        ring->packets.emplace_back(now, packet);
+        while (!ring->packets.empty() &&
+               (ring->packets.size() > capture->m_ringSize ||
+                ring->packets.front().first < now - capture->m_before))
+        {
+            ring->packets.pop_front();
+        }
+    }
+
+    void OpenWindow()
+    {
+        Time now = Simulator::Now();
+        for (auto& ring : m_rings)
+        {
+            for (const auto& entry : ring->packets)
+            {
+                if (entry.first >= now - m_before)
+                {
+                    Write(ring.get(), entry.first, entry.second);
+                }
+            }
+            ring->packets.clear();
+        }
+        if (now + m_after > m_windowEnd)
+        {
+            m_windowEnd = now + m_after;
+        }
+    }
+
+    void Write(DeviceRing* ring, Time at, Ptr<const Packet> packet)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (!ring->file)
+        {
+            // Files are created lazily, devices that never see a window stay off the disk.
+            PcapHelper pcapHelper;
+            std::string filename = pcapHelper.GetFilenameFromDevice(m_prefix, ring->device, true);
+            ring->file = pcapHelper.CreateFile(filename, std::ios::out, PcapHelper::DLT_EN10MB);
+        }
+        ring->file->Write(at, packet);
+        m_meter->writing += std::chrono::steady_clock::now() - start;
+        m_meter->packets++;
+        m_meter->bytes += packet->GetSize();
+    }
+
+    std::string m_prefix;
+    Time m_before;
+    Time m_after;
+    uint32_t m_ringSize;
+    CaptureMeter* m_meter;
+    Time m_windowEnd{Seconds(-1)};
+    uint64_t m_seen{0};
+    std::vector<std::unique_ptr<DeviceRing>> m_rings;
+};
+
+// Quote a string for the shell.
+static std::string ShellQuote(const std::string& text)
+{
+    std::string quoted = "'";
+    for (char ch : text)
+    {
+        quoted += (ch == '\'') ? std::string("'\\''") : std::string(1, ch);
+    }
+    return quoted + "'";
 }
 
-void RecoverLink(Ptr<Node> nodeA, Ptr<Node> nodeB, uint32_t interfaceA, uint32_t interfaceB)
+// Whether an option was given on the command line, as --name or --name=value.
+static bool HasOption(int argc, char** argv, const std::string& name)
 {
-    nodeA->GetObject<Ipv4>()->SetUp(interfaceA);
-    nodeB->GetObject<Ipv4>()->SetUp(interfaceB);
-    
-    // Visualize link recovery in animation
-    if (g_anim) {
-        std::string description = "Link Up";
-        g_anim->UpdateNodeColor(nodeA, 0, 255, 0); // Green for recovered node
-        g_anim->UpdateNodeColor(nodeB, 0, 255, 0);
-        g_anim->UpdateNodeDescription(nodeA, description);
-        g_anim->UpdateNodeDescription(nodeB, description);
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--" + name || arg.rfind("--" + name + "=", 0) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sweep mode: run this program once per combination of the swept options,
+// given as "option=v1,v2;option2=v3,v4", and collect the convergence and RIP
+// overhead of every run in a CSV file. All other arguments are passed on.
+static int RunSweep(int argc, char** argv, const std::string& sweep, const std::string& sweepFile)
+{
+    std::vector<std::pair<std::string, std::vector<std::string>>> dimensions;
+    std::istringstream specs(sweep);
+    std::string spec;
+    while (std::getline(specs, spec, ';'))
+    {
+        std::size_t separator = spec.find('=');
+        NS_ABORT_MSG_IF(separator == std::string::npos, "Sweep must be option=v1,v2: " << spec);
+        std::vector<std::string> values;
+        std::istringstream list(spec.substr(separator + 1));
+        std::string value;
+        while (std::getline(list, value, ','))
+        {
+            values.push_back(value);
+        }
+        NS_ABORT_MSG_IF(values.empty(), "Sweep option without values: " << spec);
+        dimensions.emplace_back(spec.substr(0, separator), values);
+    }
+
+    std::string base = ShellQuote(argv[0]) + " --capture=off --anim=off";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--sweep=", 0) != 0 && arg.rfind("--sweepFile=", 0) != 0)
+        {
+            base += " " + ShellQuote(arg);
+        }
+    }
+
+    std::ofstream out(sweepFile);
+    for (const auto& dimension : dimensions)
+    {
+        out << dimension.first << ",";
+    }
+    out << "worst_table_convergence,worst_path_convergence,unrestored_events,rip_packets,"
+           "rip_bytes,events,outage_seconds,wall_seconds,peak_rss_kb\n";
+
+    std::vector<std::size_t> index(dimensions.size(), 0);
+    std::string resultFile = sweepFile + ".run";
+    for (bool done = false; !done;)
+    {
+        std::string command = base;
+        for (std::size_t i = 0; i < dimensions.size(); ++i)
+        {
+            command += " " + ShellQuote("--" + dimensions[i].first + "=" +
+                                        dimensions[i].second[index[i]]);
+            out << dimensions[i].second[index[i]] << ",";
+        }
+        command += " " + ShellQuote("--sweepResult=" + resultFile) + " > /dev/null";
+        std::cout << "Sweep: " << command << std::endl;
+        std::remove(resultFile.c_str());
+        int status = std::system(command.c_str());
+        std::ifstream result(resultFile);
+        std::string line;
+        if (status != 0 || !std::getline(result, line))
+        {
+            line = "failed,,,,,,,,";
+        }
+        out << line << "\n";
+
+        // Next combination, the last option varies fastest
+        done = true;
+        for (std::size_t i = dimensions.size(); i-- > 0;)
+        {
+            if (++index[i] < dimensions[i].second.size())
+            {
+                done = false;
+                break;
+            }
+            index[i] = 0;
+        }
     }
+    std::remove(resultFile.c_str());
+    return 0;
 }
 
 int main(int argc, char** argv)
@@ -84,16 +2578,306 @@ int main(int argc, char** argv)
     bool printRoutingTables = false;
     bool showPings = false;
     std::string SplitHorizon("NoSplitHorizon");
+    std::string splitHorizonOverrides;
+    std::string captureMode("full");
+    double captureBefore = 2.0;
+    double captureAfter = 10.0;
+    uint32_t captureRing = 1000;
+    uint32_t captureBuffer = 1 << 20;
+    std::string traceBackend("stream");
+    uint32_t traceBufferSize = 1 << 20;
+    uint32_t traceBufferCount = 4;
+    std::string animMode("full");
+    uint64_t animMaxPackets = 0;
+    double animPollInterval = 10.0;
+    double animSampleInterval = 0.0;
+    double animSampleWindow = 1.0;
+    std::string trafficStatsFile;
+    std::string snapshotFile;
+    std::string snapshotTimes("30,60,90");
+    double snapshotInterval = 0;
+    std::string routeChangesFile;
+    double routeWatchPoll = 0.0;
+    bool reportConvergence = false;
+    bool reportCountToInfinity = false;
+    double ctiQuiet = 30.0;
+    uint32_t ctiMinIncrements = 3;
+    std::string summarize;
+    std::string dropsFile;
+    double dropInterval = 1.0;
+    std::string pingStatsFile;
+    std::string ripOverheadFile;
+    double ripOverheadInterval = 10.0;
+    bool profile = false;
+    uint32_t profileTop = 10;
+    std::string memoryFile;
+    double memoryInterval = 1.0;
+    double progressInterval = 0;
+    double ripStartupDelay = 1.0;
+    double ripUpdateInterval = 30.0;
+    double ripTimeout = 180.0;
+    double ripGarbageCollection = 120.0;
+    double ripMinTriggeredCooldown = 1.0;
+    double ripMaxTriggeredCooldown = 5.0;
+    std::string routing("rip");
+    std::string spfBenchmark;
+    uint32_t spfSources = 100;
+    std::string lpmBenchmark;
+    std::string forwardingBenchmark;
+    bool ecmp = false;
+    bool lpm = false;
+    uint32_t udpFlows = 0;
+    std::string interfaceMetrics;
+    std::string ripMode("standard");
+    double ripRetransmit = 1.0;
+    double ripPacingGap = 0;
+    double ripPacingJitter = 0;
+    uint32_t txQueueSize = 0;
+    uint32_t extraPrefixes = 0;
+    bool ripBursts = false;
+    std::string failureMode("admin");
+    bool fastDetect = false;
+    double helloInterval = 0.05;
+    uint32_t helloMultiplier = 3;
+    std::string sweep;
+    std::string sweepFile("rip-sweep.csv");
+    std::string sweepResult;
+    double trafficInterval = 1.0;
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("verbose", "turn on log components", verbose);
     cmd.AddValue("printRoutingTables", "Print routing tables at 30, 60 and 90 seconds", printRoutingTables);
-    cmd.AddValue("showPings", "Show Ping6 reception", showPings);
+    cmd.AddValue("showPings", "Show Ping reception", showPings);
     cmd.AddValue("splitHorizonStrategy", 
                  "Split Horizon strategy to use (NoSplitHorizon, SplitHorizon, PoisonReverse)",
                  SplitHorizon);
+    cmd.AddValue("splitHorizonOverrides",
+                 "Per router split horizon strategies, e.g. RouterB=PoisonReverse,RouterC=SplitHorizon",
+                 splitHorizonOverrides);
+    cmd.AddValue("capture",
+                 "Packet capture mode (full, merged, windowed, off); merged writes a single "
+                 "pcapng file, windowed only writes pcaps around link failures and recoveries",
+                 captureMode);
+    cmd.AddValue("captureBefore", "Seconds captured before each topology event", captureBefore);
+    cmd.AddValue("captureAfter", "Seconds captured after each topology event", captureAfter);
+    cmd.AddValue("captureBuffer", "Write buffer size in bytes of the merged capture", captureBuffer);
+    cmd.AddValue("traceBackend",
+                 "Trace file backend (stream, batched); batched uses aligned buffers and writev",
+                 traceBackend);
+    cmd.AddValue("traceBufferSize",
+                 "Size in bytes of each batched trace buffer, a multiple of 4096",
+                 traceBufferSize);
+    cmd.AddValue("traceBufferCount", "Number of batched trace buffers per file", traceBufferCount);
+    cmd.AddValue("captureRing", "Max packets kept in memory per device in windowed mode", captureRing);
+    cmd.AddValue("anim",
+                 "NetAnim output (off, topology, events, full); events only records link "
+                 "failures and recoveries",
+                 animMode);
+    cmd.AddValue("animMaxPackets", "Max packets recorded by --anim=full (0 = unlimited)", animMaxPackets);
+    cmd.AddValue("animPollInterval", "NetAnim node position poll interval in seconds", animPollInterval);
+    cmd.AddValue("animSampleInterval",
+                 "Record packets of --anim=full only in the first --animSampleWindow seconds of "
+                 "every interval (0 = every packet)",
+                 animSampleInterval);
+    cmd.AddValue("animSampleWindow", "Seconds of packets recorded per sampling interval", animSampleWindow);
+    cmd.AddValue("trafficStats",
+                 "Write per-device RIP/ICMP/other packets and bytes per interval to this CSV file",
+                 trafficStatsFile);
+    cmd.AddValue("trafficInterval", "Interval of the traffic statistics in seconds", trafficInterval);
+    cmd.AddValue("snapshotFile", "Write RIP table snapshots as JSON lines to this file", snapshotFile);
+    cmd.AddValue("snapshotTimes", "Comma separated snapshot times in seconds", snapshotTimes);
+    cmd.AddValue("snapshotInterval",
+                 "Snapshot every this many seconds instead of at --snapshotTimes (0 = off)",
+                 snapshotInterval);
+    cmd.AddValue("routeChanges",
+                 "Write every route add/remove/metric/next hop change to this CSV file",
+                 routeChangesFile);
+    cmd.AddValue("routeWatchPoll",
+                 "Also read every RIP table this often, in seconds (0 = only on changes)",
+                 routeWatchPoll);
+    cmd.AddValue("convergence",
+                 "Report table and path convergence time after each link failure and recovery",
+                 reportConvergence);
+    cmd.AddValue("countToInfinity", "Detect and report count-to-infinity episodes", reportCountToInfinity);
+    cmd.AddValue("ctiQuiet",
+                 "Seconds without a metric increase that end a count-to-infinity episode",
+                 ctiQuiet);
+    cmd.AddValue("ctiMinIncrements",
+                 "Successive metric increases of a prefix on one router that make a "
+                 "count-to-infinity episode",
+                 ctiMinIncrements);
+    cmd.AddValue("summarize",
+                 "Announce aggregates instead of the covered routes per interface and report "
+                 "the savings, e.g. "
+                 "\"RouterD:1=10.0.4.0/22,RouterA:2=10.0.0.0/23\"",
+                 summarize);
+    cmd.AddValue("drops",
+                 "Write per-node drop reasons and forwarding loops per interval to this CSV file",
+                 dropsFile);
+    cmd.AddValue("dropInterval", "Interval of the drop accounting in seconds", dropInterval);
+    cmd.AddValue("pingStats",
+                 "Measurement mode: no ping output, write RTT histogram and outage windows to "
+                 "this file",
+                 pingStatsFile);
+    cmd.AddValue("ripOverhead",
+                 "Write RIP requests, periodic/triggered/solicited responses, routes and bytes "
+                 "per router, interface and interval to this CSV file",
+                 ripOverheadFile);
+    cmd.AddValue("ripOverheadInterval", "Interval of the RIP overhead series in seconds", ripOverheadInterval);
+    cmd.AddValue("profile",
+                 "Report wall time and events per event type and per node after the run",
+                 profile);
+    cmd.AddValue("profileTop", "Number of top event types and nodes reported", profileTop);
+    cmd.AddValue("memory",
+                 "Write RSS, object counts, routes, queued packets, trace buffers and pending "
+                 "events per interval to this CSV file",
+                 memoryFile);
+    cmd.AddValue("memoryInterval", "Simulated seconds between memory samples", memoryInterval);
+    cmd.AddValue("progress",
+                 "Print simulated time, events/s and ETA every this many wall seconds (0 = off)",
+                 progressInterval);
+    cmd.AddValue("ripStartupDelay", "RIP startup delay in seconds", ripStartupDelay);
+    cmd.AddValue("ripUpdateInterval", "RIP unsolicited update interval in seconds", ripUpdateInterval);
+    cmd.AddValue("ripTimeout", "RIP route timeout in seconds", ripTimeout);
+    cmd.AddValue("ripGarbageCollection", "RIP garbage collection delay in seconds", ripGarbageCollection);
+    cmd.AddValue("ripMinTriggeredCooldown",
+                 "RIP minimum triggered update cooldown in seconds",
+                 ripMinTriggeredCooldown);
+    cmd.AddValue("ripMaxTriggeredCooldown",
+                 "RIP maximum triggered update cooldown in seconds",
+                 ripMaxTriggeredCooldown);
+    cmd.AddValue("routing",
+                 "Routing engine of the routers (rip, global, spf, static); global recomputes "
+                 "all shortest paths on every interface change, spf repairs the changed ones on "
+                 "link failures and recoveries, static computes them once",
+                 routing);
+    cmd.AddValue("spfBenchmark",
+                 "Only benchmark incremental against full SPF on grids of these router counts, "
+                 "e.g. 100,400,1600",
+                 spfBenchmark);
+    cmd.AddValue("spfSources",
+                 "Shortest path trees the SPF benchmark keeps, from randomly chosen routers",
+                 spfSources);
+    cmd.AddValue("lpmBenchmark",
+                 "Only benchmark the prefix trie against a linear scan for these route counts, "
+                 "e.g. 100,10000,100000",
+                 lpmBenchmark);
+    cmd.AddValue("forwardingBenchmark",
+                 "Only benchmark forwarding through Rip against the prefix trie of --lpm for "
+                 "these route counts, e.g. 100,1000,10000",
+                 forwardingBenchmark);
+    cmd.AddValue("ecmp",
+                 "Forward over all equal-metric next hops learned from RIP, per flow, and report "
+                 "packets per next hop",
+                 ecmp);
+    cmd.AddValue("lpm",
+                 "Forward transit and locally sent packets through a prefix trie of the RIP "
+                 "routes instead of Rip's linear route lookup",
+                 lpm);
+    cmd.AddValue("udpFlows", "Number of UDP flows from SrcNode to DstNode, next to the ping", udpFlows);
+    cmd.AddValue("interfaceMetrics",
+                 "Override interface metrics, e.g. RouterC:3=1,RouterD:1=1",
+                 interfaceMetrics);
+    cmd.AddValue("ripMode",
+                 "RIP operation (standard, triggered); triggered sends no periodic updates and "
+                 "exchanges full tables only when an adjacency comes up; it needs "
+                 "--failureMode=silent --fastDetect=true",
+                 ripMode);
+    cmd.AddValue("ripRetransmit",
+                 "Seconds between retransmissions of unacknowledged triggered RIP updates",
+                 ripRetransmit);
+    cmd.AddValue("ripPacingGap",
+                 "Minimum seconds between the packets of a multi-packet RIP update leaving a "
+                 "router interface (0 = off)",
+                 ripPacingGap);
+    cmd.AddValue("ripPacingJitter",
+                 "Maximum random seconds added to --ripPacingGap",
+                 ripPacingJitter);
+    cmd.AddValue("txQueueSize", "Device transmit queue size in packets (0 = ns-3 default)", txQueueSize);
+    cmd.AddValue("extraPrefixes",
+                 "Number of extra /24 prefixes announced by RouterD, to exercise large tables",
+                 extraPrefixes);
+    cmd.AddValue("ripBursts",
+                 "Report packets per RIP update, gaps between their frames and RIP drops",
+                 ripBursts);
+    cmd.AddValue("failureMode",
+                 "Link failures set the interfaces down (admin) or silently drop all frames "
+                 "(silent)",
+                 failureMode);
+    cmd.AddValue("fastDetect",
+                 "Detect silent link failures with hello frames and set the interface down",
+                 fastDetect);
+    cmd.AddValue("helloInterval", "Seconds between fast detection hellos", helloInterval);
+    cmd.AddValue("helloMultiplier", "Missed hellos before a link is declared down", helloMultiplier);
+    cmd.AddValue("sweep",
+                 "Run once per combination of options, e.g. "
+                 "\"ripUpdateInterval=10,30;ripTimeout=60,180\", and write convergence and "
+                 "overhead per run to --sweepFile",
+                 sweep);
+    cmd.AddValue("sweepFile", "CSV file of the sweep results", sweepFile);
+    cmd.AddValue("sweepResult", "Internal: file receiving the result of one sweep run", sweepResult);
     cmd.Parse(argc, argv);
 
+    if (!sweep.empty())
+    {
+        return RunSweep(argc, argv, sweep, sweepFile);
+    }
+    if (!spfBenchmark.empty())
+    {
+        return RunSpfBenchmark(spfBenchmark, spfSources);
+    }
+    if (!lpmBenchmark.empty())
+    {
+        return RunLpmBenchmark(lpmBenchmark);
+    }
+    if (!forwardingBenchmark.empty())
+    {
+        return RunForwardingBenchmark(forwardingBenchmark);
+    }
+    NS_ABORT_MSG_UNLESS(routing == "rip" || routing == "global" || routing == "spf" ||
+                            routing == "static",
+                        "Unknown routing engine: " << routing);
+    if (!sweepResult.empty())
+    {
+        reportConvergence = true;
+    }
+    NS_ABORT_MSG_IF(routing != "rip" &&
+                        (!splitHorizonOverrides.empty() || !snapshotFile.empty() ||
+                         reportCountToInfinity || !summarize.empty() ||
+                         !ripOverheadFile.empty() || ripMode != "standard"),
+                    "RIP table and overhead options need --routing=rip");
+    NS_ABORT_MSG_IF(ecmp && routing != "rip", "ECMP learns its routes from RIP, it needs --routing=rip");
+    NS_ABORT_MSG_IF(lpm && routing != "rip", "LPM learns its routes from RIP, it needs --routing=rip");
+    NS_ABORT_MSG_UNLESS(failureMode == "admin" || failureMode == "silent",
+                        "Unknown failure mode: " << failureMode);
+    NS_ABORT_MSG_IF(fastDetect && failureMode != "silent",
+                    "Fast failure detection needs --failureMode=silent");
+    g_silentFailures = (failureMode == "silent");
+    NS_ABORT_MSG_UNLESS(ripMode == "standard" || ripMode == "triggered",
+                        "Unknown RIP mode: " << ripMode);
+    // Without route timeouts only the fast failure detector learns of a link
+    // that stopped carrying traffic
+    NS_ABORT_MSG_IF(ripMode == "triggered" && !fastDetect,
+                    "Triggered RIP never times out routes, it needs --failureMode=silent "
+                    "--fastDetect=true");
+    NS_ABORT_MSG_IF(ripMode == "triggered" &&
+                        (HasOption(argc, argv, "ripUpdateInterval") ||
+                         HasOption(argc, argv, "ripTimeout")),
+                    "--ripMode=triggered has no periodic updates or route timeouts, "
+                    "--ripUpdateInterval and --ripTimeout cannot be used with it");
+    g_triggeredRip = (ripMode == "triggered");
+
+    if (profile || !memoryFile.empty() || progressInterval > 0 || !sweepResult.empty())
+    {
+        ObjectFactory schedulerFactory;
+        schedulerFactory.SetTypeId("RipSimpleRouting::InstrumentedScheduler");
+        Simulator::SetScheduler(schedulerFactory);
+        if (profile)
+        {
+            InstrumentedScheduler::Get()->EnableProfiling();
+        }
+    }
+
     if (verbose)
     {
         LogComponentEnableAll(LogLevel(LOG_PREFIX_TIME | LOG_PREFIX_NODE));
@@ -107,17 +2891,22 @@ int main(int argc, char** argv)
     }
 
     // Configure split horizon strategy
-    if (SplitHorizon == "NoSplitHorizon")
-    {
-        Config::SetDefault("ns3::RipNg::SplitHorizon", EnumValue(RipNg::NO_SPLIT_HORIZON));
-    }
-    else if (SplitHorizon == "SplitHorizon")
-    {
-        Config::SetDefault("ns3::RipNg::SplitHorizon", EnumValue(RipNg::SPLIT_HORIZON));
-    }
-    else
+    Config::SetDefault("ns3::Rip::SplitHorizon", EnumValue(ParseSplitHorizon(SplitHorizon)));
+
+    // Configure RIP timers
+    Config::SetDefault("ns3::Rip::StartupDelay", TimeValue(Seconds(ripStartupDelay)));
+    Config::SetDefault("ns3::Rip::UnsolicitedRoutingUpdate", TimeValue(Seconds(ripUpdateInterval)));
+    Config::SetDefault("ns3::Rip::TimeoutDelay", TimeValue(Seconds(ripTimeout)));
+    Config::SetDefault("ns3::Rip::GarbageCollectionDelay", TimeValue(Seconds(ripGarbageCollection)));
+    Config::SetDefault("ns3::Rip::MinTriggeredCooldown", TimeValue(Seconds(ripMinTriggeredCooldown)));
+    Config::SetDefault("ns3::Rip::MaxTriggeredCooldown", TimeValue(Seconds(ripMaxTriggeredCooldown)));
+    if (g_triggeredRip)
     {
-        Config::SetDefault("ns3::RipNg::SplitHorizon", EnumValue(RipNg::POISON_REVERSE));
+        // Periodic updates and route timeouts are pushed beyond any run, failures
+        // are learned from triggered updates only, which RipUpdateAcks
+        // acknowledges and retransmits
+        Config::SetDefault("ns3::Rip::UnsolicitedRoutingUpdate", TimeValue(Seconds(1e6)));
+        Config::SetDefault("ns3::Rip::TimeoutDelay", TimeValue(Seconds(1e6)));
     }
 
     // Create nodes
@@ -149,6 +2938,12 @@ int main(int argc, char** argv)
     NS_LOG_INFO("Create channels.");
     CsmaHelper csma;
     csma.SetChannelAttribute("DataRate", DataRateValue(5000000));
+    if (txQueueSize > 0)
+    {
+        csma.SetQueue("ns3::DropTailQueue<Packet>",
+                      "MaxSize",
+                      QueueSizeValue(QueueSize(QueueSizeUnit::PACKETS, txQueueSize)));
+    }
     
     // Set different delays for different paths
     csma.SetChannelAttribute("Delay", TimeValue(MilliSeconds(2)));
@@ -186,8 +2981,44 @@ int main(int argc, char** argv)
     ripRouting.SetInterfaceMetric(b, 2, 5);
     ripRouting.SetInterfaceMetric(c, 1, 5);
 
+    // Metric overrides, applied to RIP here and to the interfaces once they exist
+    std::vector<std::tuple<Ptr<Node>, uint32_t, uint16_t>> metricOverrides;
+    std::istringstream metricEntries(interfaceMetrics);
+    std::string metricEntry;
+    while (std::getline(metricEntries, metricEntry, ','))
+    {
+        std::size_t colon = metricEntry.find(':');
+        std::size_t equals = metricEntry.find('=');
+        NS_ABORT_MSG_IF(colon == std::string::npos || equals == std::string::npos || equals < colon,
+                        "Interface metric must be Router:Interface=Metric: " << metricEntry);
+        Ptr<Node> router = Names::Find<Node>(metricEntry.substr(0, colon));
+        NS_ABORT_MSG_IF(!router || router == src || router == dst,
+                        "Unknown router in interface metric: " << metricEntry);
+        uint32_t interface = std::stoul(metricEntry.substr(colon + 1, equals - colon - 1));
+        uint32_t metric = std::stoul(metricEntry.substr(equals + 1));
+        NS_ABORT_MSG_IF(interface == 0 || metric == 0 || metric > 15,
+                        "Bad interface or metric in interface metric: " << metricEntry);
+        ripRouting.SetInterfaceMetric(router, interface, metric);
+        metricOverrides.emplace_back(router, interface, metric);
+    }
+
     Ipv4ListRoutingHelper listRH;
-    listRH.Add(ripRouting, 0);
+    if (routing == "rip")
+    {
+        listRH.Add(ripRouting, 0);
+    }
+    else if (routing == "global")
+    {
+        // Recompute all routes whenever an interface goes down or up
+        Config::SetDefault("ns3::Ipv4GlobalRouting::RespondToInterfaceEvents", BooleanValue(true));
+        Ipv4GlobalRoutingHelper globalRouting;
+        listRH.Add(globalRouting, 0);
+    }
+    else
+    {
+        Ipv4StaticRoutingHelper staticRoutingHelper;
+        listRH.Add(staticRoutingHelper, 0);
+    }
 
     InternetStackHelper internet;
     internet.SetIpv6StackInstall(false);
@@ -198,30 +3029,155 @@ int main(int argc, char** argv)
     internetNodes.SetIpv6StackInstall(false);
     internetNodes.Install(nodes);
 
+    // ECMP ahead of RIP in every router's list routing
+    std::vector<Ptr<RipEcmpRouting>> ecmpRouting;
+    for (auto it = routers.Begin(); it != routers.End() && ecmp; ++it)
+    {
+        Ptr<Ipv4ListRouting> list =
+            DynamicCast<Ipv4ListRouting>((*it)->GetObject<Ipv4>()->GetRoutingProtocol());
+        TimeValue timeout;
+        GetRip(*it)->GetAttribute("TimeoutDelay", timeout);
+        Ptr<RipEcmpRouting> protocol = CreateObject<RipEcmpRouting>();
+        protocol->SetAttribute("Timeout", timeout);
+        list->AddRoutingProtocol(protocol, 10);
+        ecmpRouting.push_back(protocol);
+    }
+
+    // Prefix trie forwarding between ECMP and RIP, learning from the RIP responses
+    std::vector<Ptr<RipLpmRouting>> lpmRouting;
+    for (auto it = routers.Begin(); it != routers.End() && lpm; ++it)
+    {
+        Ptr<Ipv4ListRouting> list =
+            DynamicCast<Ipv4ListRouting>((*it)->GetObject<Ipv4>()->GetRoutingProtocol());
+        Ptr<RipLpmRouting> protocol = CreateObject<RipLpmRouting>();
+        list->AddRoutingProtocol(protocol, 5);
+        lpmRouting.push_back(protocol);
+    }
+
+    // Pace RIP packets on the router interfaces, before the address helper
+    // installs the default queue discs. Summarization rewrites the RIP
+    // responses in the same queue disc.
+    if (ripPacingGap > 0 || ripPacingJitter > 0 || !summarize.empty())
+    {
+        TrafficControlHelper pacing;
+        pacing.SetRootQueueDisc("RipSimpleRouting::RipPacingQueueDisc",
+                                "Gap",
+                                TimeValue(Seconds(ripPacingGap)),
+                                "Jitter",
+                                TimeValue(Seconds(ripPacingJitter)));
+        for (auto it = routers.Begin(); it != routers.End(); ++it)
+        {
+            for (uint32_t i = 0; i < (*it)->GetNDevices(); ++i)
+            {
+                if (DynamicCast<CsmaNetDevice>((*it)->GetDevice(i)))
+                {
+                    pacing.Install((*it)->GetDevice(i));
+                }
+            }
+        }
+    }
+
+    // Per router split horizon strategies
+    std::map<uint32_t, std::string> strategyOf;
+    for (auto it = routers.Begin(); it != routers.End(); ++it)
+    {
+        strategyOf[(*it)->GetId()] = SplitHorizon;
+    }
+    std::istringstream overrides(splitHorizonOverrides);
+    std::string overrideEntry;
+    while (std::getline(overrides, overrideEntry, ','))
+    {
+        std::size_t separator = overrideEntry.find('=');
+        NS_ABORT_MSG_IF(separator == std::string::npos,
+                        "Split horizon override must be Router=Strategy: " << overrideEntry);
+        Ptr<Node> router = Names::Find<Node>(overrideEntry.substr(0, separator));
+        NS_ABORT_MSG_IF(!router || strategyOf.find(router->GetId()) == strategyOf.end(),
+                        "Unknown router in split horizon override: " << overrideEntry);
+        std::string strategy = overrideEntry.substr(separator + 1);
+        GetRip(router)->SetAttribute("SplitHorizon", EnumValue(ParseSplitHorizon(strategy)));
+        strategyOf[router->GetId()] = strategy;
+    }
+    for (auto it = routers.Begin(); it != routers.End() && routing == "rip"; ++it)
+    {
+        std::cout << Names::FindName(*it) << " split horizon: " << strategyOf[(*it)->GetId()]
+                  << std::endl;
+    }
+
     // Assign IP addresses
     NS_LOG_INFO("Assign IPv4 Addresses.");
     Ipv4AddressHelper ipv4;
 
     ipv4.SetBase(Ipv4Address("10.0.0.0"), Ipv4Mask("255.255.255.0"));
-    Ipv4InterfaceContainer iic1 = ipv4.Assign(ndc1);
+    ipv4.Assign(ndc1);
 
     ipv4.SetBase(Ipv4Address("10.0.1.0"), Ipv4Mask("255.255.255.0"));
-    Ipv4InterfaceContainer iic2 = ipv4.Assign(ndc2);
+    ipv4.Assign(ndc2);
 
     ipv4.SetBase(Ipv4Address("10.0.2.0"), Ipv4Mask("255.255.255.0"));
-    Ipv4InterfaceContainer iic3 = ipv4.Assign(ndc3);
+    ipv4.Assign(ndc3);
 
     ipv4.SetBase(Ipv4Address("10.0.3.0"), Ipv4Mask("255.255.255.0"));
-    Ipv4InterfaceContainer iic4 = ipv4.Assign(ndc4);
+    ipv4.Assign(ndc4);
 
     ipv4.SetBase(Ipv4Address("10.0.4.0"), Ipv4Mask("255.255.255.0"));
-    Ipv4InterfaceContainer iic5 = ipv4.Assign(ndc5);
+    ipv4.Assign(ndc5);
 
     ipv4.SetBase(Ipv4Address("10.0.5.0"), Ipv4Mask("255.255.255.0"));
-    Ipv4InterfaceContainer iic6 = ipv4.Assign(ndc6);
+    ipv4.Assign(ndc6);
 
     ipv4.SetBase(Ipv4Address("10.0.6.0"), Ipv4Mask("255.255.255.0"));
-    Ipv4InterfaceContainer iic7 = ipv4.Assign(ndc7);
+    ipv4.Assign(ndc7);
+
+    // Extra prefixes 20.0.0.0/24, 20.0.1.0/24, ... on the target network
+    NS_ABORT_MSG_IF(extraPrefixes > 65536, "At most 65536 extra prefixes");
+    if (extraPrefixes > 0)
+    {
+        std::vector<Ipv4InterfaceAddress> addresses;
+        for (uint32_t i = 0; i < extraPrefixes; ++i)
+        {
+            addresses.emplace_back(Ipv4Address((20u << 24) | (i << 8) | 1),
+                                   Ipv4Mask("255.255.255.0"));
+        }
+        uint32_t before = CollectRipRoutes(GetRip(d)).size();
+        AddAnnouncedAddresses(d, 3, addresses);
+        uint32_t routes = CollectRipRoutes(GetRip(d)).size();
+        NS_ABORT_MSG_IF(routes != before + extraPrefixes,
+                        "RouterD has " << routes - before << " of " << extraPrefixes
+                                       << " extra prefixes in its RIP table");
+        std::cout << "RouterD announces " << routes << " routes, " << extraPrefixes
+                  << " of them extra" << std::endl;
+    }
+
+    // Interface metrics for global and static routing, the same as for RIP
+    c->GetObject<Ipv4>()->SetMetric(3, 10);
+    d->GetObject<Ipv4>()->SetMetric(1, 10);
+    b->GetObject<Ipv4>()->SetMetric(2, 5);
+    c->GetObject<Ipv4>()->SetMetric(1, 5);
+    for (const auto& metricOverride : metricOverrides)
+    {
+        Ptr<Ipv4> routerIpv4 = std::get<0>(metricOverride)->GetObject<Ipv4>();
+        NS_ABORT_MSG_IF(std::get<1>(metricOverride) >= routerIpv4->GetNInterfaces(),
+                        "Unknown interface in interface metric: "
+                            << Names::FindName(std::get<0>(metricOverride)) << ":"
+                            << std::get<1>(metricOverride));
+        routerIpv4->SetMetric(std::get<1>(metricOverride), std::get<2>(metricOverride));
+    }
+    std::unique_ptr<ShortestPathRoutes> spfRoutes;
+    if (routing == "global")
+    {
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    }
+    else if (routing == "spf" || routing == "static")
+    {
+        spfRoutes = std::make_unique<ShortestPathRoutes>(routers);
+        spfRoutes->Install();
+    }
+    if (routing == "spf")
+    {
+        g_interfaceListeners.push_back([&spfRoutes](Ptr<Node> node, uint32_t interface, bool up) {
+            spfRoutes->InterfaceChanged(node, interface, up);
+        });
+    }
 
     // Configure static routes
     Ptr<Ipv4StaticRouting> staticRouting;
@@ -234,7 +3190,7 @@ int main(int argc, char** argv)
     staticRouting->SetDefaultRoute("10.0.6.1", 1);
 
     // Print routing tables
-    if (!printRoutingTables)
+    if (printRoutingTables)
     {
         Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper>(&std::cout);
 
@@ -254,6 +3210,27 @@ int main(int argc, char** argv)
         Ipv4RoutingHelper::PrintRoutingTableAt(Seconds(90.0), d, routingStream);
     }
 
+    Time stopTime = Seconds(131.0);
+
+    std::unique_ptr<RoutingSnapshots> snapshots;
+    if (!snapshotFile.empty())
+    {
+        snapshots = std::make_unique<RoutingSnapshots>(snapshotFile, routers);
+        if (snapshotInterval > 0)
+        {
+            snapshots->ScheduleEvery(Seconds(snapshotInterval), stopTime);
+        }
+        else
+        {
+            std::istringstream times(snapshotTimes);
+            std::string at;
+            while (std::getline(times, at, ','))
+            {
+                snapshots->ScheduleAt(Seconds(std::stod(at)));
+            }
+        }
+    }
+
     // Create ping application
     NS_LOG_INFO("Create Applications.");
     uint32_t packetSize = 1024;
@@ -262,51 +3239,483 @@ int main(int argc, char** argv)
 
     ping.SetAttribute("Interval", TimeValue(interPacketInterval));
     ping.SetAttribute("Size", UintegerValue(packetSize));
-    if (!showPings)
+    if (!pingStatsFile.empty() || !sweepResult.empty())
+    {
+        ping.SetAttribute("VerboseMode", EnumValue(Ping::VerboseMode::SILENT));
+    }
+    else if (showPings)
     {
         ping.SetAttribute("VerboseMode", EnumValue(Ping::VerboseMode::VERBOSE));
     }
+    else
+    {
+        ping.SetAttribute("VerboseMode", EnumValue(Ping::VerboseMode::QUIET));
+    }
     ApplicationContainer apps = ping.Install(src);
     apps.Start(Seconds(1.0));
     apps.Stop(Seconds(110.0));
 
+    // UDP flows on their own ports, so ECMP can spread them
+    for (uint32_t i = 0; i < udpFlows; ++i)
+    {
+        UdpServerHelper server(9000 + i);
+        ApplicationContainer serverApps = server.Install(dst);
+        serverApps.Start(Seconds(1.0));
+        serverApps.Stop(Seconds(110.0));
+        UdpClientHelper client(Ipv4Address("10.0.6.2"), 9000 + i);
+        client.SetAttribute("MaxPackets", UintegerValue(0));
+        client.SetAttribute("Interval", TimeValue(MilliSeconds(100)));
+        client.SetAttribute("PacketSize", UintegerValue(512));
+        ApplicationContainer clientApps = client.Install(src);
+        clientApps.Start(Seconds(2.0));
+        clientApps.Stop(Seconds(110.0));
+    }
+
+    std::unique_ptr<PingStats> pingStats;
+    if (!pingStatsFile.empty() || !sweepResult.empty())
+    {
+        TimeValue timeout;
+        apps.Get(0)->GetAttribute("Timeout", timeout);
+        pingStats = std::make_unique<PingStats>(apps.Get(0),
+                                                Seconds(1.0),
+                                                Seconds(110.0),
+                                                interPacketInterval,
+                                                timeout.Get());
+    }
+
     // Enable traces
-    AsciiTraceHelper ascii;
-    csma.EnableAsciiAll(ascii.CreateFileStream("rip-simple-routing.tr"));
-    csma.EnablePcapAll("rip-simple-routing", true);
+    NetDeviceContainer allDevices;
+    for (const auto& ndc : {ndc1, ndc2, ndc3, ndc4, ndc5, ndc6, ndc7})
+    {
+        allDevices.Add(ndc);
+    }
+
+    std::vector<std::unique_ptr<TraceOutput>> traceOutputs;
+    CaptureMeter captureMeter;
+    std::unique_ptr<PcapCapture> fullCapture;
+    std::unique_ptr<WindowedPcapCapture> windowedCapture;
+    std::unique_ptr<PcapngCapture> mergedCapture;
+    if (captureMode == "full")
+    {
+        traceOutputs.push_back(std::make_unique<TraceOutput>("rip-simple-routing.tr",
+                                                             traceBackend,
+                                                             traceBufferSize,
+                                                             traceBufferCount,
+                                                             true));
+        csma.EnableAsciiAll(Create<OutputStreamWrapper>(traceOutputs.back()->GetStream()));
+        fullCapture = std::make_unique<PcapCapture>("rip-simple-routing", &captureMeter);
+        fullCapture->Install(allDevices);
+    }
+    else if (captureMode == "merged")
+    {
+        traceOutputs.push_back(std::make_unique<TraceOutput>("rip-simple-routing.pcapng",
+                                                             traceBackend,
+                                                             traceBufferSize,
+                                                             traceBufferCount,
+                                                             false));
+        mergedCapture = std::make_unique<PcapngCapture>(traceOutputs.back()->GetStream(),
+                                                        captureBuffer,
+                                                        &captureMeter);
+        mergedCapture->Install(allDevices);
+    }
+    else if (captureMode == "windowed")
+    {
+        windowedCapture = std::make_unique<WindowedPcapCapture>("rip-simple-routing",
+                                                                Seconds(captureBefore),
+                                                                Seconds(captureAfter),
+                                                                captureRing,
+                                                                &captureMeter);
+        windowedCapture->Install(allDevices);
+    }
+    else if (captureMode != "off")
+    {
+        NS_FATAL_ERROR("Unknown capture mode: " << captureMode);
+    }
+
+    std::unique_ptr<DropAccounting> drops;
+    if (!dropsFile.empty())
+    {
+        drops = std::make_unique<DropAccounting>(Seconds(dropInterval));
+    }
+
+    std::unique_ptr<RipOverhead> ripOverhead;
+    if (!ripOverheadFile.empty() || (!sweepResult.empty() && routing == "rip"))
+    {
+        ripOverhead = std::make_unique<RipOverhead>(routers, Seconds(ripOverheadInterval), strategyOf);
+    }
+
+    std::unique_ptr<RipBurstStats> ripBurstStats;
+    if (ripBursts)
+    {
+        ripBurstStats = std::make_unique<RipBurstStats>(routers);
+    }
+
+    std::unique_ptr<TrafficStats> trafficStats;
+    if (!trafficStatsFile.empty())
+    {
+        trafficStats = std::make_unique<TrafficStats>(Seconds(trafficInterval));
+        trafficStats->Install(allDevices);
+    }
 
     // Configure animation
-    AnimationInterface anim("rip-simple-routing-" + SplitHorizon + ".xml");
-    g_anim = &anim;  // Store animation interface pointer
-    
-    // Position nodes
-    anim.SetConstantPosition(src, 0.0, 0.0);
-    anim.SetConstantPosition(a, 2.0, 1.0);
-    anim.SetConstantPosition(b, 4.0, 0.0);
-    anim.SetConstantPosition(c, 2.0, -1.0);
-    anim.SetConstantPosition(d, 6.0, 0.0);
-    anim.SetConstantPosition(dst, 8.0, 0.0);
-
-    // Set node descriptions
-    anim.UpdateNodeDescription(a, "Router A\n" + SplitHorizon);
-    anim.UpdateNodeDescription(b, "Router B\n" + SplitHorizon);
-    anim.UpdateNodeDescription(c, "Router C\n" + SplitHorizon);
-    anim.UpdateNodeDescription(d, "Router D\n" + SplitHorizon);
+    std::unique_ptr<AnimationInterface> anim;
+    std::unique_ptr<AnimPacketSampler> animSampler;
+    if (animMode == "topology" || animMode == "events" || animMode == "full")
+    {
+        anim = std::make_unique<AnimationInterface>("rip-simple-routing-" + SplitHorizon + ".xml");
+        // Positions are constant, polling them is pure XML overhead
+        anim->SetMobilityPollInterval(Seconds(animPollInterval));
+        if (animMode == "full")
+        {
+            NS_ABORT_MSG_IF(animSampleInterval > 0 &&
+                                (animSampleWindow <= 0 || animSampleWindow > animSampleInterval),
+                            "--animSampleWindow must be positive and at most --animSampleInterval");
+            animSampler = std::make_unique<AnimPacketSampler>(anim.get(),
+                                                              animMaxPackets,
+                                                              Seconds(animSampleInterval),
+                                                              Seconds(animSampleWindow));
+        }
+        else
+        {
+            anim->SkipPacketTracing();
+        }
+        if (animMode != "topology")
+        {
+            g_anim = anim.get(); // Store animation interface pointer
+        }
+
+        // Position nodes
+        anim->SetConstantPosition(src, 0.0, 0.0);
+        anim->SetConstantPosition(a, 2.0, 1.0);
+        anim->SetConstantPosition(b, 4.0, 0.0);
+        anim->SetConstantPosition(c, 2.0, -1.0);
+        anim->SetConstantPosition(d, 6.0, 0.0);
+        anim->SetConstantPosition(dst, 8.0, 0.0);
+
+        // Set node descriptions
+        anim->UpdateNodeDescription(a, "Router A\n" + strategyOf[a->GetId()]);
+        anim->UpdateNodeDescription(b, "Router B\n" + strategyOf[b->GetId()]);
+        anim->UpdateNodeDescription(c, "Router C\n" + strategyOf[c->GetId()]);
+        anim->UpdateNodeDescription(d, "Router D\n" + strategyOf[d->GetId()]);
+    }
+    else if (animMode != "off")
+    {
+        NS_FATAL_ERROR("Unknown anim mode: " << animMode);
+    }
 
     // Set up link failures and recoveries
-    Simulator::Schedule(Seconds(40), &TearDownLink, b, d, 3, 2);
-    Simulator::Schedule(Seconds(60), &TearDownLink, c, d, 2, 1);
-    
-    // Schedule link recoveries
-    Simulator::Schedule(Seconds(80), &RecoverLink, b, d, 3, 2);
-    Simulator::Schedule(Seconds(100), &RecoverLink, c, d, 2, 1);
+    const std::vector<TopologyEvent> topologyEvents = {
+        {Seconds(40), false, b, d, 3, 2, "B-D down"},
+        {Seconds(60), false, c, d, 2, 1, "C-D down"},
+        {Seconds(80), true, b, d, 3, 2, "B-D up"},
+        {Seconds(100), true, c, d, 2, 1, "C-D up"},
+    };
+    for (const auto& event : topologyEvents)
+    {
+        Simulator::Schedule(event.at,
+                            event.up ? &RecoverLink : &TearDownLink,
+                            event.nodeA,
+                            event.nodeB,
+                            event.interfaceA,
+                            event.interfaceB);
+    }
+
+    std::unique_ptr<RipUpdateAcks> ripAcks;
+    if (g_triggeredRip)
+    {
+        ripAcks = std::make_unique<RipUpdateAcks>(Seconds(ripRetransmit));
+        for (auto it = routers.Begin(); it != routers.End(); ++it)
+        {
+            ripAcks->Install(*it);
+        }
+    }
+
+    std::unique_ptr<FastFailureDetector> fastDetector;
+    if (fastDetect)
+    {
+        fastDetector = std::make_unique<FastFailureDetector>(Seconds(helloInterval), helloMultiplier);
+        for (const auto& ndc : {ndc2, ndc3, ndc4, ndc5, ndc6})
+        {
+            fastDetector->AddLink(ndc.Get(0), ndc.Get(1));
+        }
+    }
+
+    if (pingStats)
+    {
+        for (const auto& event : topologyEvents)
+        {
+            pingStats->AddEvent(event.at, event.description);
+        }
+    }
+
+    if (windowedCapture)
+    {
+        for (const auto& event : topologyEvents)
+        {
+            windowedCapture->AddEvent(event.at);
+        }
+    }
+
+    std::unique_ptr<RouteWatcher> routeWatcher;
+    std::unique_ptr<ConvergenceDetector> convergence;
+    std::unique_ptr<CountToInfinityDetector> countToInfinity;
+    if (!routeChangesFile.empty() || reportConvergence || reportCountToInfinity)
+    {
+        routeWatcher = std::make_unique<RouteWatcher>(routers, Seconds(routeWatchPoll));
+        if (!routeChangesFile.empty())
+        {
+            routeWatcher->WriteTo(routeChangesFile);
+        }
+        if (reportConvergence)
+        {
+            convergence = std::make_unique<ConvergenceDetector>(
+                routeWatcher.get(), routing == "rip" ? SplitHorizon : routing);
+            convergence->AddProbe(a, Ipv4Address("10.0.6.2"));
+            convergence->AddProbe(d, Ipv4Address("10.0.0.1"));
+            for (const auto& event : topologyEvents)
+            {
+                convergence->AddEvent(event.at, event.description);
+            }
+        }
+        if (reportCountToInfinity)
+        {
+            countToInfinity = std::make_unique<CountToInfinityDetector>(routeWatcher.get(),
+                                                                        Seconds(ctiQuiet),
+                                                                        ctiMinIncrements);
+        }
+    }
+
+    std::unique_ptr<RouteSummarization> summarization;
+    if (!summarize.empty())
+    {
+        std::vector<RouteSummarization::Policy> policies;
+        std::istringstream entries(summarize);
+        std::string entry;
+        while (std::getline(entries, entry, ','))
+        {
+            std::size_t colon = entry.find(':');
+            std::size_t equals = entry.find('=');
+            std::size_t slash = entry.find('/');
+            NS_ABORT_MSG_IF(colon == std::string::npos || equals < colon ||
+                                equals == std::string::npos || slash < equals ||
+                                slash == std::string::npos,
+                            "Summary must be Router:Interface=Prefix/Length: " << entry);
+            RouteSummarization::Policy policy;
+            policy.node = Names::Find<Node>(entry.substr(0, colon));
+            NS_ABORT_MSG_IF(!policy.node ||
+                                strategyOf.find(policy.node->GetId()) == strategyOf.end(),
+                            "Unknown router in summary: " << entry);
+            policy.interface = std::stoul(entry.substr(colon + 1, equals - colon - 1));
+            uint32_t nInterfaces = policy.node->GetObject<Ipv4>()->GetNInterfaces();
+            NS_ABORT_MSG_IF(policy.interface == 0 || policy.interface >= nInterfaces,
+                            "Unknown interface in summary: " << entry);
+            uint32_t length = std::stoul(entry.substr(slash + 1));
+            NS_ABORT_MSG_IF(length > 32, "Bad prefix length in summary: " << entry);
+            policy.mask = Ipv4Mask(length == 0 ? 0 : 0xFFFFFFFFu << (32 - length));
+            std::string prefix = entry.substr(equals + 1, slash - equals - 1);
+            policy.prefix = Ipv4Address(prefix.c_str()).CombineMask(policy.mask);
+            policies.push_back(policy);
+        }
+        summarization = std::make_unique<RouteSummarization>(policies);
+    }
+
+    std::unique_ptr<MemorySampler> memorySampler;
+    if (!memoryFile.empty())
+    {
+        memorySampler = std::make_unique<MemorySampler>(memoryFile, Seconds(memoryInterval));
+        memorySampler->AddGauge("rip_routes", [&routers]() {
+            uint64_t routes = 0;
+            for (auto it = routers.Begin(); it != routers.End(); ++it)
+            {
+                Ptr<Rip> rip = GetRip(*it);
+                routes += rip ? CollectRipRoutes(rip).size() : 0;
+            }
+            return routes;
+        });
+        memorySampler->AddGauge("queued_packets", []() {
+            uint64_t packets = 0;
+            for (uint32_t i = 0; i < NodeList::GetNNodes(); ++i)
+            {
+                Ptr<Node> node = NodeList::GetNode(i);
+                Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+                for (uint32_t j = 0; j < node->GetNDevices(); ++j)
+                {
+                    Ptr<CsmaNetDevice> csmaDevice = DynamicCast<CsmaNetDevice>(node->GetDevice(j));
+                    if (csmaDevice)
+                    {
+                        packets += csmaDevice->GetQueue()->GetNPackets();
+                    }
+                    Ptr<QueueDisc> queueDisc =
+                        tc ? tc->GetRootQueueDiscOnDevice(node->GetDevice(j)) : nullptr;
+                    if (queueDisc)
+                    {
+                        packets += queueDisc->GetNPackets();
+                    }
+                }
+            }
+            return packets;
+        });
+        memorySampler->AddGauge("trace_buffer_bytes", [&windowedCapture, &traceOutputs]() {
+            uint64_t bytes = windowedCapture ? windowedCapture->GetRingBytes() : 0;
+            for (const auto& output : traceOutputs)
+            {
+                bytes += output->GetBufferBytes();
+            }
+            return bytes;
+        });
+        memorySampler->Start();
+    }
 
     NS_LOG_INFO("Run Simulation.");
-    Simulator::Stop(Seconds(131.0));
+    if (progressInterval > 0)
+    {
+        InstrumentedScheduler::Get()->EnableProgress(progressInterval, stopTime);
+    }
+    Simulator::Stop(stopTime);
+    auto runStart = std::chrono::steady_clock::now();
     Simulator::Run();
+    std::chrono::duration<double> runWall = std::chrono::steady_clock::now() - runStart;
+
+    if (profile)
+    {
+        InstrumentedScheduler::Get()->Report(std::cout, profileTop);
+    }
+    if (memorySampler)
+    {
+        std::cout << "Peak RSS: " << memorySampler->GetPeakRssKb() << " kB" << std::endl;
+    }
+    std::cout << "Routing engine " << routing << ": " << runWall.count() << " s wall time";
+    if (InstrumentedScheduler::Get())
+    {
+        std::cout << ", " << InstrumentedScheduler::Get()->GetEventCount() << " events";
+    }
+    std::cout << ", peak RSS " << MemorySampler::GetPeakRssKb() << " kB" << std::endl;
+
+    if (captureMode != "off")
+    {
+        if (mergedCapture)
+        {
+            mergedCapture->Flush();
+        }
+        double writing = std::chrono::duration<double>(captureMeter.writing).count();
+        std::cout << "Capture (" << captureMode << "): " << captureMeter.packets << " packets, "
+                  << captureMeter.bytes << " bytes written in " << writing << " s";
+        if (writing > 0)
+        {
+            std::cout << ", " << captureMeter.packets / writing << " packets/s, "
+                      << captureMeter.bytes / writing / 1e6 << " MB/s";
+        }
+        std::cout << std::endl;
+        for (const auto& output : traceOutputs)
+        {
+            output->Flush();
+            output->Report(std::cout, runWall.count());
+        }
+    }
+
+    if (windowedCapture)
+    {
+        std::cout << "Windowed capture wrote " << captureMeter.packets << " of "
+                  << windowedCapture->GetSeenPackets() << " sniffed packets" << std::endl;
+    }
+    if (ripAcks)
+    {
+        ripAcks->Report(std::cout);
+    }
+    if (fastDetector)
+    {
+        fastDetector->Report(std::cout);
+    }
+    if (routing == "spf")
+    {
+        spfRoutes->Report(std::cout);
+    }
+    for (const auto& protocol : ecmpRouting)
+    {
+        protocol->Report(std::cout);
+    }
+    for (const auto& protocol : lpmRouting)
+    {
+        protocol->Report(std::cout);
+    }
+    if (convergence)
+    {
+        convergence->Report(std::cout);
+    }
+    if (countToInfinity)
+    {
+        countToInfinity->Report(std::cout);
+    }
+    if (summarization)
+    {
+        summarization->Report(std::cout);
+    }
+    if (pingStats)
+    {
+        pingStats->Report(std::cout);
+        if (!pingStatsFile.empty())
+        {
+            pingStats->Write(pingStatsFile);
+        }
+    }
+    if (ripOverhead)
+    {
+        ripOverhead->Report(std::cout);
+        if (!ripOverheadFile.empty())
+        {
+            ripOverhead->Write(ripOverheadFile);
+        }
+    }
+    if (ripBurstStats)
+    {
+        ripBurstStats->Report(std::cout);
+    }
+    if (drops)
+    {
+        drops->Report(std::cout);
+        drops->Write(dropsFile);
+    }
+    if (trafficStats)
+    {
+        trafficStats->Write(trafficStatsFile);
+    }
+    if (!sweepResult.empty())
+    {
+        std::ofstream result(sweepResult);
+        if (convergence)
+        {
+            double worstTables;
+            double worstPaths;
+            uint32_t unrestored;
+            convergence->Summarize(worstTables, worstPaths, unrestored);
+            result << worstTables << "," << worstPaths << "," << unrestored;
+        }
+        else
+        {
+            result << ",,";
+        }
+        result << ",";
+        if (ripOverhead)
+        {
+            result << ripOverhead->GetTotal(RipOverhead::REQUESTS_TX) +
+                          ripOverhead->GetTotal(RipOverhead::PERIODIC_TX) +
+                          ripOverhead->GetTotal(RipOverhead::TRIGGERED_TX) +
+                          ripOverhead->GetTotal(RipOverhead::SOLICITED_TX)
+                   << "," << ripOverhead->GetTotal(RipOverhead::BYTES_TX);
+        }
+        else
+        {
+            result << ",";
+        }
+        result << "," << InstrumentedScheduler::Get()->GetEventCount() << ","
+               << pingStats->GetOutageTime().GetSeconds() << "," << runWall.count() << ","
+               << MemorySampler::GetPeakRssKb() << "\n";
+    }
+
     Simulator::Destroy();
     NS_LOG_INFO("Done.");
     
     g_anim = nullptr;  // Clear animation interface pointer
+    g_interfaceListeners.clear();
     return 0;
 }
@@ -0,0 +1,467 @@
+// Shortest path first routing computed from the topology.
+
+#ifndef RIP_SPF_H
+#define RIP_SPF_H
+
+#include "rip-common.h"
+
+#include "ns3/ipv4-static-routing-helper.h"
+
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+// Shortest path trees of a directed graph, kept for the routers added as
+// sources. When links go down or up the trees are repaired in place: a
+// failed tree link only resets the subtree below it, which is reattached
+// from the rest of the tree, and a recovered link only propagates the
+// distances it shortens.
+class SpfGraph
+{
+  public:
+    static constexpr uint32_t UNREACHABLE = std::numeric_limits<uint32_t>::max();
+
+    uint32_t AddRouter()
+    {
+        m_out.emplace_back();
+        m_in.emplace_back();
+        m_treeOf.push_back(-1);
+        return m_out.size() - 1;
+    }
+
+    uint32_t AddLink(uint32_t from, uint32_t to, uint32_t cost)
+    {
+        m_links.push_back({from, to, cost, true});
+        m_out[from].push_back(m_links.size() - 1);
+        m_in[to].push_back(m_links.size() - 1);
+        return m_links.size() - 1;
+    }
+
+    uint32_t GetNRouters() const
+    {
+        return m_out.size();
+    }
+
+    uint32_t GetNLinks() const
+    {
+        return m_links.size();
+    }
+
+    uint32_t GetNTrees() const
+    {
+        return m_trees.size();
+    }
+
+    uint32_t GetLinkFrom(uint32_t link) const
+    {
+        return m_links[link].from;
+    }
+
+    uint32_t GetLinkTo(uint32_t link) const
+    {
+        return m_links[link].to;
+    }
+
+    bool IsLinkUp(uint32_t link) const
+    {
+        return m_links[link].up;
+    }
+
+    // Keep the tree of a router from now on, 12 bytes per router.
+    void AddSource(uint32_t source)
+    {
+        if (m_treeOf[source] < 0)
+        {
+            m_treeOf[source] = m_trees.size();
+            m_trees.emplace_back();
+            m_trees.back().source = source;
+            Compute(m_trees.back());
+        }
+    }
+
+    void ComputeAll()
+    {
+        for (uint32_t source = 0; source < m_out.size(); ++source)
+        {
+            AddSource(source);
+        }
+    }
+
+    // Compute every kept tree from scratch.
+    void Recompute()
+    {
+        for (auto& tree : m_trees)
+        {
+            Compute(tree);
+        }
+    }
+
+    // Set links down or up and repair the kept trees. Returns the sources
+    // whose tree changed.
+    std::vector<uint32_t> SetLinks(const std::vector<uint32_t>& links, bool up)
+    {
+        for (uint32_t link : links)
+        {
+            m_links[link].up = up;
+        }
+        std::vector<uint32_t> affected;
+        for (auto& tree : m_trees)
+        {
+            bool changed = false;
+            if (up)
+            {
+                changed = Shorten(tree, links);
+            }
+            else
+            {
+                for (uint32_t id : links)
+                {
+                    if (tree.parent[m_links[id].to] == static_cast<int32_t>(id))
+                    {
+                        Detach(tree, m_links[id].to);
+                        changed = true;
+                    }
+                }
+            }
+            if (changed)
+            {
+                affected.push_back(tree.source);
+            }
+        }
+        return affected;
+    }
+
+    uint32_t GetDistance(uint32_t source, uint32_t router) const
+    {
+        return m_trees[m_treeOf[source]].distance[router];
+    }
+
+    // The link leaving the source towards a router, -1 for none.
+    int32_t GetFirstHop(uint32_t source, uint32_t router) const
+    {
+        return m_trees[m_treeOf[source]].firstHop[router];
+    }
+
+  private:
+    struct Link
+    {
+        uint32_t from;
+        uint32_t to;
+        uint32_t cost;
+        bool up;
+    };
+
+    struct Tree
+    {
+        uint32_t source;
+        std::vector<uint32_t> distance;
+        std::vector<int32_t> parent;   // Link reaching each router
+        std::vector<int32_t> firstHop; // Link of the source leading there
+    };
+
+    using Entry = std::pair<uint32_t, uint32_t>; // Distance, router
+    using Queue = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>;
+
+    void Compute(Tree& tree)
+    {
+        tree.distance.assign(m_out.size(), UNREACHABLE);
+        tree.parent.assign(m_out.size(), -1);
+        tree.firstHop.assign(m_out.size(), -1);
+        tree.distance[tree.source] = 0;
+        Queue queue;
+        queue.emplace(0, tree.source);
+        Propagate(tree, queue);
+    }
+
+    // Reach a router over a link, when that is shorter than its distance.
+    bool Relax(Tree& tree, uint32_t id, Queue& queue)
+    {
+        const Link& link = m_links[id];
+        if (!link.up || tree.distance[link.from] == UNREACHABLE ||
+            tree.distance[link.from] + link.cost >= tree.distance[link.to])
+        {
+            return false;
+        }
+        tree.distance[link.to] = tree.distance[link.from] + link.cost;
+        tree.parent[link.to] = id;
+        tree.firstHop[link.to] = (link.from == tree.source) ? id : tree.firstHop[link.from];
+        queue.emplace(tree.distance[link.to], link.to);
+        return true;
+    }
+
+    // Dijkstra from the queued routers; the others keep their distances.
+    void Propagate(Tree& tree, Queue& queue)
+    {
+        while (!queue.empty())
+        {
+            Entry entry = queue.top();
+            queue.pop();
+            if (entry.first > tree.distance[entry.second])
+            {
+                continue;
+            }
+            for (uint32_t id : m_out[entry.second])
+            {
+                Relax(tree, id, queue);
+            }
+        }
+    }
+
+    // A recovered link can only shorten paths: start from the routers it
+    // reaches faster. Their subtrees follow, as every child gets shorter too.
+    bool Shorten(Tree& tree, const std::vector<uint32_t>& links)
+    {
+        Queue queue;
+        bool changed = false;
+        for (uint32_t id : links)
+        {
+            changed = Relax(tree, id, queue) || changed;
+        }
+        Propagate(tree, queue);
+        return changed;
+    }
+
+    // The tree link into a router failed: only the routers below it can get
+    // longer paths. Reset them and reattach them over the links from the
+    // rest of the tree, whose distances stay valid.
+    void Detach(Tree& tree, uint32_t root)
+    {
+        std::vector<uint32_t> subtree{root};
+        for (std::size_t i = 0; i < subtree.size(); ++i)
+        {
+            for (uint32_t id : m_out[subtree[i]])
+            {
+                if (tree.parent[m_links[id].to] == static_cast<int32_t>(id))
+                {
+                    subtree.push_back(m_links[id].to);
+                }
+            }
+        }
+        for (uint32_t router : subtree)
+        {
+            tree.distance[router] = UNREACHABLE;
+            tree.parent[router] = -1;
+            tree.firstHop[router] = -1;
+        }
+        Queue queue;
+        for (uint32_t router : subtree)
+        {
+            for (uint32_t id : m_in[router])
+            {
+                Relax(tree, id, queue);
+            }
+        }
+        Propagate(tree, queue);
+    }
+
+    std::vector<Link> m_links;
+    std::vector<std::vector<uint32_t>> m_out; // Links leaving each router
+    std::vector<std::vector<uint32_t>> m_in;  // Links reaching each router
+    std::vector<int32_t> m_treeOf;            // Tree index by source, -1 for none
+    std::vector<Tree> m_trees;
+};
+
+// Shortest path routing computed from the topology itself: routers sharing
+// a network are neighbors, at the metric of the outgoing interface, which
+// is how RIP and global routing count costs. The route to every network is
+// installed in each router's static routing. On interface changes only the
+// routers whose tree changed get their routes replaced.
+class ShortestPathRoutes
+{
+  public:
+    explicit ShortestPathRoutes(const NodeContainer& routers)
+    {
+        std::map<uint32_t, uint32_t> routerOf;
+        for (auto it = routers.Begin(); it != routers.End(); ++it)
+        {
+            routerOf[(*it)->GetId()] = m_graph.AddRouter();
+            Router router;
+            router.node = *it;
+            router.ipv4 = (*it)->GetObject<Ipv4>();
+            router.routing =
+                Ipv4RoutingHelper::GetRouting<Ipv4StaticRouting>(router.ipv4->GetRoutingProtocol());
+            m_routers.push_back(router);
+        }
+        for (uint32_t r = 0; r < m_routers.size(); ++r)
+        {
+            Router& router = m_routers[r];
+            for (uint32_t i = 1; i < router.ipv4->GetNInterfaces(); ++i)
+            {
+                for (uint32_t j = 0; j < router.ipv4->GetNAddresses(i); ++j)
+                {
+                    Ipv4InterfaceAddress address = router.ipv4->GetAddress(i, j);
+                    router.networks.push_back(
+                        {address.GetLocal().CombineMask(address.GetMask()), address.GetMask()});
+                }
+                Ptr<NetDevice> device = router.ipv4->GetNetDevice(i);
+                Ptr<Channel> channel = device->GetChannel();
+                for (std::size_t k = 0; channel && k < channel->GetNDevices(); ++k)
+                {
+                    Ptr<NetDevice> peer = channel->GetDevice(k);
+                    auto neighbor = routerOf.find(peer->GetNode()->GetId());
+                    if (peer == device || neighbor == routerOf.end())
+                    {
+                        continue;
+                    }
+                    Ptr<Ipv4> peerIpv4 = peer->GetNode()->GetObject<Ipv4>();
+                    Link link;
+                    link.interface = i;
+                    link.peerInterface = peerIpv4->GetInterfaceForDevice(peer);
+                    link.gateway = peerIpv4->GetAddress(link.peerInterface, 0).GetLocal();
+                    m_graph.AddLink(r, neighbor->second, router.ipv4->GetMetric(i));
+                    m_links.push_back(link);
+                }
+            }
+        }
+    }
+
+    // Compute the shortest path tree of every router and install its routes.
+    void Install()
+    {
+        m_graph.ComputeAll();
+        for (uint32_t source = 0; source < m_routers.size(); ++source)
+        {
+            InstallRoutes(source);
+        }
+    }
+
+    // Follow an interface going down or up. A link is only used while the
+    // interfaces at both ends are up, so the first end to come back after
+    // a failure changes nothing.
+    void InterfaceChanged(Ptr<Node> node, uint32_t interface, bool up)
+    {
+        std::vector<uint32_t> links;
+        for (uint32_t id = 0; id < m_links.size(); ++id)
+        {
+            const Link& link = m_links[id];
+            const Router& from = m_routers[m_graph.GetLinkFrom(id)];
+            const Router& to = m_routers[m_graph.GetLinkTo(id)];
+            bool usable = from.ipv4->IsUp(link.interface) && to.ipv4->IsUp(link.peerInterface);
+            if (((from.node == node && link.interface == interface) ||
+                 (to.node == node && link.peerInterface == interface)) &&
+                usable != m_graph.IsLinkUp(id))
+            {
+                links.push_back(id);
+            }
+        }
+        if (links.empty())
+        {
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint32_t> affected = m_graph.SetLinks(links, up);
+        for (uint32_t source : affected)
+        {
+            InstallRoutes(source);
+        }
+        std::chrono::duration<double, std::micro> wall = std::chrono::steady_clock::now() - start;
+        m_updates.push_back({Simulator::Now(), Names::FindName(node), interface, up,
+                             static_cast<uint32_t>(affected.size()), wall.count()});
+    }
+
+    void Report(std::ostream& os) const
+    {
+        for (const auto& update : m_updates)
+        {
+            os << "SPF: " << update.node << " if " << update.interface
+               << (update.up ? " up" : " down") << " at " << update.time.GetSeconds()
+               << " s repaired " << update.trees << " of " << m_routers.size() << " trees in "
+               << update.wallUs << " us" << std::endl;
+        }
+    }
+
+  private:
+    struct Network
+    {
+        Ipv4Address prefix;
+        Ipv4Mask mask;
+    };
+
+    struct Router
+    {
+        Ptr<Node> node;
+        Ptr<Ipv4> ipv4;
+        Ptr<Ipv4StaticRouting> routing;
+        std::vector<Network> networks;
+    };
+
+    // Graph link details, by graph link id
+    struct Link
+    {
+        uint32_t interface;
+        uint32_t peerInterface;
+        Ipv4Address gateway;
+    };
+
+    struct Update
+    {
+        Time time;
+        std::string node;
+        uint32_t interface;
+        bool up;
+        uint32_t trees;
+        double wallUs;
+    };
+
+    // Replace the routes of a router with the routes of its current tree:
+    // every network not attached to it goes via its nearest router.
+    void InstallRoutes(uint32_t source)
+    {
+        using NetworkKey = std::pair<uint32_t, uint32_t>;
+        std::map<NetworkKey, uint32_t> nearest; // Network to router
+        for (uint32_t router = 0; router < m_routers.size(); ++router)
+        {
+            if (m_graph.GetFirstHop(source, router) < 0)
+            {
+                continue;
+            }
+            for (const auto& network : m_routers[router].networks)
+            {
+                NetworkKey key(network.prefix.Get(), network.mask.Get());
+                auto found = nearest.find(key);
+                if (found == nearest.end() ||
+                    m_graph.GetDistance(source, router) < m_graph.GetDistance(source, found->second))
+                {
+                    nearest[key] = router;
+                }
+            }
+        }
+        Router& router = m_routers[source];
+        for (const auto& network : router.networks)
+        {
+            nearest.erase(NetworkKey(network.prefix.Get(), network.mask.Get()));
+        }
+        for (uint32_t i = router.routing->GetNRoutes(); i-- > 0;)
+        {
+            if (router.routing->GetRoute(i).IsGateway())
+            {
+                router.routing->RemoveRoute(i);
+            }
+        }
+        for (const auto& entry : nearest)
+        {
+            uint32_t id = m_graph.GetFirstHop(source, entry.second);
+            router.routing->AddNetworkRouteTo(Ipv4Address(entry.first.first),
+                                              Ipv4Mask(entry.first.second),
+                                              m_links[id].gateway,
+                                              m_links[id].interface,
+                                              m_graph.GetDistance(source, entry.second));
+        }
+    }
+
+    SpfGraph m_graph;
+    std::vector<Router> m_routers;
+    std::vector<Link> m_links;
+    std::vector<Update> m_updates;
+};
+
+} // namespace ns3
+
+#endif // RIP_SPF_H
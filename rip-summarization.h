@@ -0,0 +1,313 @@
+// Route summarization in the RIP responses of a router.
+
+#ifndef RIP_SUMMARIZATION_H
+#define RIP_SUMMARIZATION_H
+
+#include "rip-pacing.h"
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace ns3
+{
+
+// Per-interface route summarization. For each policy (router, interface,
+// aggregate) a rewriter in the RipPacingQueueDisc of the interface replaces
+// the covered routes in the RIP responses the router sends there by the
+// aggregate, with the best metric of its components. The savings are in
+// the neighbors' tables and updates; the router itself still keeps every
+// component. The aggregate is only announced while all components seen so
+// far are reachable. Once one of them fails the responses carry the
+// components again, the reachable ones included, and the aggregate with
+// metric 16, so the neighbors do not send the traffic of the failed
+// component here.
+class RouteSummarization
+{
+  public:
+    struct Policy
+    {
+        Ptr<Node> node;
+        uint32_t interface;
+        Ipv4Address prefix;
+        Ipv4Mask mask;
+    };
+
+    explicit RouteSummarization(const std::vector<Policy>& policies)
+    {
+        for (const auto& policy : policies)
+        {
+            auto summary = std::make_unique<Summary>();
+            summary->policy = policy;
+            summary->rip = GetRip(policy.node);
+            summary->splitHorizon = GetSplitHorizon(summary->rip);
+            Ptr<Ipv4> ipv4 = policy.node->GetObject<Ipv4>();
+            summary->address = ipv4->GetAddress(policy.interface, 0).GetLocal();
+            Ptr<NetDevice> device = ipv4->GetNetDevice(policy.interface);
+            Ptr<RipPacingQueueDisc> queueDisc = DynamicCast<RipPacingQueueDisc>(
+                policy.node->GetObject<TrafficControlLayer>()->GetRootQueueDiscOnDevice(device));
+            NS_ABORT_MSG_IF(!queueDisc,
+                            "Summarization needs the RIP queue disc on "
+                                << Names::FindName(policy.node) << " interface "
+                                << policy.interface);
+            Summary* state = summary.get();
+            queueDisc->AddRewriter([this, state](RipHeader& response) { Rewrite(state, response); });
+            m_summaries.push_back(std::move(summary));
+        }
+    }
+
+    void Report(std::ostream& os)
+    {
+        os << "Route summarization:" << std::endl;
+        for (auto& summary : m_summaries)
+        {
+            const Policy& policy = summary->policy;
+            os << "  " << Names::FindName(policy.node) << " if " << policy.interface << " "
+               << policy.prefix << "/" << policy.mask.GetPrefixLength() << ": "
+               << summary->before.routes << " -> " << summary->after.routes << " routes, "
+               << summary->before.bytes << " -> " << summary->after.bytes << " bytes, "
+               << summary->before.packets << " -> " << summary->after.packets
+               << " RIP responses sent" << std::endl;
+            for (const auto& neighbor : GetLinkNeighbors(policy.node, policy.interface))
+            {
+                Ptr<Rip> rip = GetRip(neighbor.first);
+                if (!rip)
+                {
+                    continue;
+                }
+                uint32_t stored = 0;
+                for (const auto& route : CollectRipRoutes(rip))
+                {
+                    if (route.gateway == summary->address && Covers(policy, route))
+                    {
+                        stored++;
+                    }
+                }
+                os << "    " << Names::FindName(neighbor.first) << " stores " << stored
+                   << " covered routes from it" << std::endl;
+            }
+            for (const auto& event : summary->events)
+            {
+                os << "    " << event.time.GetSeconds() << " s: " << StateName(event.state)
+                   << ", " << event.reachable << " of " << event.components
+                   << " components reachable";
+                if (event.state != WITHDRAWN)
+                {
+                    os << ", metric " << event.metric;
+                }
+                os << std::endl;
+            }
+            Time partial = summary->partialTime;
+            if (summary->state == PARTIAL)
+            {
+                partial += Simulator::Now() - summary->since;
+            }
+            os << "    Partial coverage for " << partial.GetSeconds() << " s" << std::endl;
+        }
+    }
+
+  private:
+    enum State
+    {
+        NONE,
+        COMPLETE,
+        PARTIAL,
+        WITHDRAWN
+    };
+
+    struct Event
+    {
+        Time time;
+        State state;
+        uint32_t reachable;
+        uint32_t components;
+        uint32_t metric;
+    };
+
+    struct Traffic
+    {
+        uint64_t packets{0};
+        uint64_t routes{0};
+        uint64_t bytes{0};
+    };
+
+    using RouteKey = std::pair<uint32_t, uint32_t>; // Destination and mask
+
+    struct Summary
+    {
+        Policy policy;
+        Ptr<Rip> rip;
+        Rip::SplitHorizonType_e splitHorizon;
+        Ipv4Address address;
+        std::set<RouteKey> components; // Every covered route seen so far
+        std::vector<RipRoute> reachable;
+        bool advertised{false};        // Neighbors may hold the aggregate
+        Traffic before;
+        Traffic after;
+        Time announced{Seconds(-1)};
+        uint32_t metric{16};
+        State state{NONE};
+        Time since;
+        Time partialTime;
+        std::vector<Event> events;
+    };
+
+    static const char* StateName(State state)
+    {
+        switch (state)
+        {
+        case NONE:
+            return "none";
+        case COMPLETE:
+            return "complete";
+        case PARTIAL:
+            return "partial";
+        case WITHDRAWN:
+            return "withdrawn";
+        }
+        return "unknown";
+    }
+
+    // Routes more specific than the aggregate; the aggregate itself, e.g.
+    // learned back from a neighbor, is no component.
+    static bool Covers(const Policy& policy, const RipRoute& route)
+    {
+        return route.mask.GetPrefixLength() > policy.mask.GetPrefixLength() &&
+               route.destination.CombineMask(policy.mask) == policy.prefix;
+    }
+
+    static bool Covers(const Policy& policy, const RipRte& rte)
+    {
+        return rte.GetSubnetMask().GetPrefixLength() > policy.mask.GetPrefixLength() &&
+               rte.GetPrefix().CombineMask(policy.mask) == policy.prefix;
+    }
+
+    static bool IsAggregate(const Policy& policy, const RipRte& rte)
+    {
+        return rte.GetSubnetMask() == policy.mask && rte.GetPrefix() == policy.prefix;
+    }
+
+    static RipRte MakeRte(Ipv4Address prefix, Ipv4Mask mask, uint32_t metric)
+    {
+        RipRte rte;
+        rte.SetPrefix(prefix);
+        rte.SetSubnetMask(mask);
+        rte.SetRouteTag(0);
+        rte.SetRouteMetric(metric);
+        return rte;
+    }
+
+    // One RIP response on the wire: IPv4, UDP and RIP headers plus 20 bytes
+    // per route
+    static void Count(Traffic& traffic, const RipHeader& response)
+    {
+        if (response.GetRteNumber() > 0)
+        {
+            traffic.packets++;
+            traffic.routes += response.GetRteNumber();
+            traffic.bytes += 20 + 8 + response.GetSerializedSize();
+        }
+    }
+
+    void Rewrite(Summary* summary, RipHeader& response)
+    {
+        Count(summary->before, response);
+        auto rtes = response.GetRteList();
+        const Policy& policy = summary->policy;
+        if (std::none_of(rtes.begin(), rtes.end(), [&policy](const RipRte& rte) {
+                return Covers(policy, rte);
+            }))
+        {
+            Count(summary->after, response);
+            return;
+        }
+        // Rip splits one update into several responses sent at once, the
+        // aggregate goes into the first one that carried a covered route
+        bool first = summary->announced != Simulator::Now();
+        if (first)
+        {
+            summary->announced = Simulator::Now();
+            Update(summary);
+        }
+        bool summarize = summary->state == COMPLETE;
+        response.ClearRtes();
+        std::set<RouteKey> kept;
+        for (const auto& rte : rtes)
+        {
+            if (IsAggregate(policy, rte) || (summarize && Covers(policy, rte)))
+            {
+                continue;
+            }
+            kept.insert({rte.GetPrefix().Get(), rte.GetSubnetMask().Get()});
+            response.AddRte(rte);
+        }
+        if (first && summarize)
+        {
+            summary->advertised = true;
+            response.AddRte(MakeRte(policy.prefix, policy.mask, summary->metric));
+        }
+        else if (first && summary->advertised)
+        {
+            response.AddRte(MakeRte(policy.prefix, policy.mask, 16));
+            for (const auto& component : summary->reachable)
+            {
+                if (!kept.count({component.destination.Get(), component.mask.Get()}))
+                {
+                    response.AddRte(
+                        MakeRte(component.destination, component.mask, component.metric));
+                }
+            }
+        }
+        Count(summary->after, response);
+    }
+
+    // The aggregate from the router's current table. Routes learned on the
+    // policy interface are not announced there, or only poisoned, so they
+    // do not count unless split horizon is off.
+    void Update(Summary* summary)
+    {
+        uint32_t metric = 16;
+        summary->reachable.clear();
+        for (const auto& route : CollectRipRoutes(summary->rip))
+        {
+            if (!Covers(summary->policy, route) ||
+                (summary->splitHorizon != Rip::NO_SPLIT_HORIZON &&
+                 route.interface == summary->policy.interface))
+            {
+                continue;
+            }
+            summary->components.insert({route.destination.Get(), route.mask.Get()});
+            if (route.metric < 16)
+            {
+                summary->reachable.push_back(route);
+                metric = std::min(metric, route.metric);
+            }
+        }
+        summary->metric = metric;
+        uint32_t reachable = summary->reachable.size();
+
+        uint32_t components = summary->components.size();
+        State state = (reachable == 0)            ? WITHDRAWN
+                      : (reachable < components) ? PARTIAL
+                                                  : COMPLETE;
+        bool metricChanged = !summary->events.empty() && summary->events.back().metric != metric;
+        if (state == summary->state && !metricChanged)
+        {
+            return;
+        }
+        if (summary->state == PARTIAL)
+        {
+            summary->partialTime += Simulator::Now() - summary->since;
+        }
+        summary->since = Simulator::Now();
+        summary->state = state;
+        summary->events.push_back({Simulator::Now(), state, reachable, components, metric});
+    }
+
+    std::vector<std::unique_ptr<Summary>> m_summaries;
+};
+
+} // namespace ns3
+
+#endif // RIP_SUMMARIZATION_H